@@ -0,0 +1,728 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <atomic>
+#include <cstdint>
+#include "shm_layout.h"
+#include "agent_stats.h"
+#include "agent_probes.h"
+#include "percpu_counters.h"
+#include "size_histogram.h"
+#include "site_sketch.h"
+#include "site_ages.h"
+#include "topk_sites.h"
+#include "site_rates.h"
+#include "site_trend.h"
+#include "changepoint.h"
+
+// ========================================
+// ADVANCED AGENT WITH O(1) HEADER TRICK
+// ========================================
+
+// Global state
+static LeakDetectionBuffer* leak_buffer = nullptr;
+static int shm_fd = -1;
+static volatile uint32_t next_event_id = 1;
+static std::atomic<int> event_counter{0};
+static std::atomic<uint64_t> staleness_threshold_ns{3000000000ULL}; // 3 seconds for demo
+
+// Function pointers to original functions
+static void* (*real_malloc)(size_t) = nullptr;
+static void (*real_free)(void*) = nullptr;
+static void* (*real_realloc)(void*, size_t) = nullptr;
+static void* (*real_calloc)(size_t, size_t) = nullptr;
+
+// Statistics tracking: per-CPU counters (percpu_counters.h), summed by
+// readers; the scanner thread copies the sums into the buffer header
+
+// Magic number for header validation
+#define ALLOC_MAGIC 0xDEADBEEF
+
+// Simple active allocations tracking for leak detection
+#define MAX_TRACKED_ALLOCS 10000
+static struct {
+    void* address;
+    AllocationMeta* meta;
+} active_allocs[MAX_TRACKED_ALLOCS];
+static volatile int active_alloc_count = 0;
+
+// Helper functions
+static inline uint64_t get_timestamp_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline uint32_t get_thread_id() {
+    return (uint32_t)pthread_self();
+}
+
+static inline uint32_t get_call_site_id() {
+    // Simple hash of return address for call site identification
+    void* caller = __builtin_return_address(0);
+    return (uint32_t)((uintptr_t)caller >> 4) & 0xFFFF;
+}
+
+// Add allocation to tracking list
+static void track_allocation(void* user_ptr, AllocationMeta* meta) {
+    if (active_alloc_count < MAX_TRACKED_ALLOCS) {
+        int index = active_alloc_count++;
+        active_allocs[index].address = user_ptr;
+        active_allocs[index].meta = meta;
+    }
+}
+
+// Remove allocation from tracking list  
+static void untrack_allocation(void* user_ptr) {
+    for (int i = 0; i < active_alloc_count; i++) {
+        if (active_allocs[i].address == user_ptr) {
+            // Remove by swapping with last element
+            active_allocs[i] = active_allocs[active_alloc_count - 1];
+            active_alloc_count--;
+            break;
+        }
+    }
+}
+
+// Write event to shared memory
+static void write_leak_event(int event_type, void* data) {
+    if (!leak_buffer) return;
+    AgentProbeTimer timer(PROBE_PUBLISH);
+    
+    LeakEvent event = {};  // Zero-initialize all fields
+    event.event_id = next_event_id++;
+    event.event_type = event_type;
+    event.timestamp = get_timestamp_ns();
+    event.thread_id = static_cast<uint32_t>(pthread_self());
+    event.is_valid = 1;
+    
+    // Copy event-specific data
+    if (data) {
+        memcpy(&event.data, data, sizeof(event.data));
+    }
+    
+    // Write to circular buffer
+    int slot = leak_buffer->write_index % LEAK_BUFFER_SIZE;
+    if (slot == 0 && leak_buffer->write_index > 0) {
+        // Starting a new lap: unread events from the last one are overwritten
+        AGENT_PROBE2(ring_overflow, leak_buffer->write_index, leak_buffer->read_index);
+    }
+    leak_buffer->events[slot] = event;
+    leak_buffer->write_index++;
+}
+
+// Validate allocation header
+static inline bool is_valid_allocation(AllocationMeta* meta) {
+    return meta && meta->magic == ALLOC_MAGIC;
+}
+
+// Get metadata from user pointer - O(1) operation!
+static inline AllocationMeta* get_meta_from_user_ptr(void* user_ptr) {
+    if (!user_ptr) return nullptr;
+    return ((AllocationMeta*)user_ptr) - 1;
+}
+
+// Get user pointer from metadata
+static inline void* get_user_ptr_from_meta(AllocationMeta* meta) {
+    return (void*)(meta + 1);
+}
+
+// Update access time (called by memory access sampling)
+extern "C" void update_allocation_access(void* addr) {
+    if (!addr) return;
+    
+    AllocationMeta* meta = get_meta_from_user_ptr(addr);
+    if (is_valid_allocation(meta)) {
+        meta->last_access = get_timestamp_ns();
+    }
+}
+
+// Check if allocation is potentially leaked
+static bool is_potentially_leaked(AllocationMeta* meta) {
+    if (!is_valid_allocation(meta)) return false;
+    
+    uint64_t now = get_timestamp_ns();
+    uint64_t staleness = now - meta->last_access;
+    
+    return staleness > staleness_threshold_ns.load();
+}
+
+// Report potential leak
+static void report_leak(AllocationMeta* meta, void* user_ptr) {
+    uint64_t now = get_timestamp_ns();
+    uint64_t staleness = now - meta->last_access;
+    
+    struct {
+        void* address;
+        size_t size;
+        uint64_t staleness_ns;
+        uint32_t site_id;
+    } leak_data = {
+        user_ptr,
+        meta->size,
+        staleness,
+        meta->site_id
+    };
+    
+    AGENT_PROBE4(leak_report, user_ptr, meta->size, staleness, meta->site_id);
+    write_leak_event(EVENT_LEAK_DETECTED, &leak_data);
+    
+    leak_buffer->leak_count++;
+    
+    // Also log to stderr for immediate visibility
+    fprintf(stderr, "[LEAK] %p: %zu bytes, stale for %.2fs, site_id=%u\n",
+            user_ptr, meta->size, staleness / 1e9, meta->site_id);
+}
+
+// ========================================
+// ALLOCATOR LATENCY PROFILE (optional)
+// ========================================
+
+// Times the real malloc/free on every call while enabled; histograms are
+// thread-local and merged into shm every AGENT_STATS_FLUSH_EVERY calls
+static volatile int alloc_profiling = 0;
+static std::atomic<uint64_t> outlier_threshold_ns{20000};
+static __thread LocalHistogram profile_local[2][ALLOC_SIZE_CLASSES] __attribute__((tls_model("initial-exec")));
+static __thread uint32_t profile_pending __attribute__((tls_model("initial-exec")));
+
+static inline int alloc_size_class(size_t size) {
+    int c = 63 - __builtin_clzll(size | 1) - 4;
+    if (c < 0) return 0;
+    return c < ALLOC_SIZE_CLASSES ? c : ALLOC_SIZE_CLASSES - 1;
+}
+
+static void profile_flush() {
+    profile_pending = 0;
+    if (!leak_buffer) return;
+    for (int op = 0; op < 2; op++) {
+        for (int c = 0; c < ALLOC_SIZE_CLASSES; c++) {
+            agent_hist_merge(leak_buffer->alloc_profile.latency[op][c], profile_local[op][c]);
+        }
+    }
+}
+
+// Slow call: add it to its site's entry (open addressing on site/op)
+static void record_outlier(int op, uint32_t site_id, size_t size, uint64_t cycles) {
+    AllocatorProfile& profile = leak_buffer->alloc_profile;
+    uint32_t key = ((site_id << 1) | op) + 1;
+    for (uint32_t probe = 0; probe < 16; probe++) {
+        AllocOutlierSite& entry = profile.outlier_sites[(key * 2654435761u + probe) % ALLOC_OUTLIER_SITES];
+        uint32_t expected = 0;
+        if (__atomic_load_n(&entry.key, __ATOMIC_ACQUIRE) != key &&
+            !__atomic_compare_exchange_n(&entry.key, &expected, key, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) &&
+            expected != key) {
+            continue;  // taken by another site
+        }
+        entry.site_id = site_id;
+        entry.op = op;
+        __atomic_fetch_add(&entry.count, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&entry.total_cycles, cycles, __ATOMIC_RELAXED);
+        uint64_t max = __atomic_load_n(&entry.max_cycles, __ATOMIC_RELAXED);
+        while (cycles > max && !__atomic_compare_exchange_n(&entry.max_cycles, &max, cycles, true,
+                                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+        uint64_t max_size = __atomic_load_n(&entry.max_size, __ATOMIC_RELAXED);
+        while (size > max_size && !__atomic_compare_exchange_n(&entry.max_size, &max_size, (uint64_t)size, true,
+                                                               __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+        return;
+    }
+    __atomic_fetch_add(&profile.outlier_overflow, 1, __ATOMIC_RELAXED);
+}
+
+static inline void profile_real_call(int op, size_t size, uint32_t site_id, uint64_t cycles) {
+    if (!leak_buffer) return;
+    LocalHistogram& local = profile_local[op][alloc_size_class(size)];
+    local.count++;
+    agent_hist_sample(local, cycles);
+    if (cycles > leak_buffer->alloc_profile.outlier_cycles) record_outlier(op, site_id, size, cycles);
+    if (++profile_pending >= AGENT_STATS_FLUSH_EVERY) profile_flush();
+}
+
+// Enable/disable allocator profiling; calls slower than outlier_us are
+// attributed to their site
+extern "C" void set_alloc_profiling(int enabled, double outlier_us) {
+    if (outlier_us > 0) outlier_threshold_ns.store((uint64_t)(outlier_us * 1000));
+    if (leak_buffer) {
+        AllocatorProfile& profile = leak_buffer->alloc_profile;
+        if (enabled) agent_stats_calibrate_now();
+        uint64_t cycles_per_sec = leak_buffer->stats.cycles_per_sec;
+        profile.outlier_cycles = cycles_per_sec ? outlier_threshold_ns.load() * cycles_per_sec / 1000000000ULL
+                                                : outlier_threshold_ns.load();
+        profile.enabled = enabled ? 1 : 0;
+    }
+    alloc_profiling = enabled && leak_buffer;
+}
+
+// Enable/disable the per-site rate sketch; epsilon/delta <= 0 keep the
+// defaults. Resizing clears it, since columns move.
+extern "C" void set_site_rate_sketch(int enabled, double epsilon, double delta) {
+    CountMinSketch* cms = site_rates;
+    site_rates_enabled = 0;
+    if (!cms) return;
+    cms->enabled = 0;
+    site_rates_configure(cms, epsilon, delta);
+    memset(cms->counts, 0, sizeof(cms->counts));
+    memset(cms->bytes, 0, sizeof(cms->bytes));
+    uint64_t now = get_timestamp_ns();
+    for (int w = 0; w < CMS_WINDOWS; w++) cms->window_start_ns[w] = now;
+    cms->enabled = enabled ? 1 : 0;
+    site_rates_enabled = enabled;
+}
+
+// Advanced malloc with header trick
+extern "C" void* malloc(size_t size) {
+    if (!real_malloc) {
+        real_malloc = (void*(*)(size_t))dlsym(RTLD_NEXT, "malloc");
+    }
+    
+    if (size == 0) return nullptr;
+    AgentProbeTimer timer(PROBE_MALLOC_HOOK);
+    
+    // Allocate extra space for metadata header
+    size_t total_size = size + sizeof(AllocationMeta);
+    uint64_t real_start = alloc_profiling ? agent_cycles() : 0;
+    void* real_ptr = real_malloc(total_size);
+    if (real_start) {
+        profile_real_call(ALLOC_OP_MALLOC, size, get_call_site_id(), agent_cycles() - real_start);
+    }
+    
+    if (!real_ptr) return nullptr;
+    
+    // Initialize metadata header
+    AllocationMeta* meta = (AllocationMeta*)real_ptr;
+    meta->magic = ALLOC_MAGIC;
+    meta->size = size;
+    meta->alloc_time = get_timestamp_ns();
+    meta->last_access = meta->alloc_time;  // Initial access = allocation time
+    meta->site_id = get_call_site_id();
+    meta->thread_id = get_thread_id();
+    
+    // Calculate user pointer (after header)
+    void* user_ptr = get_user_ptr_from_meta(meta);
+    
+    // Track this allocation for leak detection
+    track_allocation(user_ptr, meta);
+    
+    // Update statistics
+    percpu_add(CTR_ALLOCATIONS, 1);
+    percpu_add(CTR_CURRENT_BYTES, (int64_t)size);
+    size_hist_record(ALLOC_OP_MALLOC, size);
+    SiteSketches* site = site_sketch_malloc(meta->site_id, (uintptr_t)__builtin_return_address(0), size);
+    site_age_malloc(site, meta->alloc_time, size);
+    topk_record(meta->site_id, (int64_t)size);
+    site_rates_record(meta->site_id, size);
+    
+    if (leak_buffer) {
+        // Log allocation event
+        struct {
+            void* address;
+            size_t size;
+            uint64_t alloc_time;
+            uint32_t site_id;
+        } alloc_data = {user_ptr, size, meta->alloc_time, meta->site_id};
+        
+        write_leak_event(EVENT_MALLOC, &alloc_data);
+    }
+    
+    AGENT_PROBE3(malloc, user_ptr, size, meta->site_id);
+    return user_ptr;
+}
+
+// Advanced free with O(1) metadata lookup
+extern "C" void free(void* ptr) {
+    if (!real_free) {
+        real_free = (void(*)(void*))dlsym(RTLD_NEXT, "free");
+    }
+    
+    if (!ptr) return;
+    AgentProbeTimer timer(PROBE_FREE_HOOK);
+    
+    // Get metadata using header trick - O(1)!
+    AllocationMeta* meta = get_meta_from_user_ptr(ptr);
+    
+    if (!is_valid_allocation(meta)) {
+        // Not our allocation or corrupted header
+        real_free(ptr);
+        return;
+    }
+    
+    AGENT_PROBE3(free, ptr, meta->size, meta->site_id);
+
+    // Update statistics
+    percpu_add(CTR_FREES, 1);
+    percpu_add(CTR_CURRENT_BYTES, -(int64_t)meta->size);
+    size_hist_record(ALLOC_OP_FREE, meta->size);
+    SiteSketches* site = site_sketch_free(meta->site_id, get_timestamp_ns() - meta->alloc_time);
+    site_age_free(site, meta->alloc_time, meta->size);
+    topk_record(meta->site_id, -(int64_t)meta->size);
+    
+    // Remove from tracking
+    untrack_allocation(ptr);
+    
+    if (leak_buffer) {
+        // Log free event
+        struct {
+            void* address;
+            size_t size;
+            uint64_t alloc_time;
+            uint32_t site_id;
+        } free_data = {ptr, meta->size, meta->alloc_time, meta->site_id};
+        
+        write_leak_event(EVENT_FREE, &free_data);
+    }
+    
+    // Clear magic to detect double-free
+    meta->magic = 0;
+    
+    // Free the real pointer (including header)
+    if (alloc_profiling) {
+        size_t size = meta->size;
+        uint32_t site_id = meta->site_id;
+        uint64_t real_start = agent_cycles();
+        real_free((void*)meta);
+        profile_real_call(ALLOC_OP_FREE, size, site_id, agent_cycles() - real_start);
+        return;
+    }
+    real_free((void*)meta);
+}
+
+// Realloc implementation
+extern "C" void* realloc(void* ptr, size_t size) {
+    if (!real_realloc) {
+        real_realloc = (void*(*)(void*, size_t))dlsym(RTLD_NEXT, "realloc");
+    }
+    
+    if (!ptr) return malloc(size);
+    if (size == 0) {
+        free(ptr);
+        return nullptr;
+    }
+    
+    // Get old metadata
+    AllocationMeta* old_meta = get_meta_from_user_ptr(ptr);
+    if (!is_valid_allocation(old_meta)) {
+        // Not our allocation, pass through
+        return real_realloc(ptr, size);
+    }
+    
+    size_t old_size = old_meta->size;
+    
+    // Allocate new block
+    void* new_ptr = malloc(size);
+    if (!new_ptr) return nullptr;
+    
+    // Copy old data
+    size_t copy_size = (size < old_size) ? size : old_size;
+    memcpy(new_ptr, ptr, copy_size);
+    
+    // Free old block
+    free(ptr);
+    
+    AGENT_PROBE3(realloc, ptr, new_ptr, size);
+    return new_ptr;
+}
+
+// Calloc implementation
+extern "C" void* calloc(size_t nmemb, size_t size) {
+    if (!real_calloc) {
+        real_calloc = (void*(*)(size_t, size_t))dlsym(RTLD_NEXT, "calloc");
+    }
+    
+    size_t total_size = nmemb * size;
+    void* ptr = malloc(total_size);
+    
+    if (ptr) {
+        memset(ptr, 0, total_size);
+    }
+    
+    return ptr;
+}
+
+// Scanner timing, exported through get_scanner_stats()
+static std::atomic<uint64_t> scan_interval_ms{5000};  // 0 = paused
+static std::atomic<uint64_t> scan_count{0};
+static std::atomic<uint64_t> total_scan_ns{0};
+static std::atomic<uint64_t> max_scan_ns{0};
+static std::atomic<uint64_t> last_scan_tracked{0};
+
+// Joined by the destructor before the segment goes away: every tick
+// writes into it. A forked child has no scanner to join (scanner_pid).
+static std::atomic<bool> scanner_running{false};
+static pthread_t scanner_thread;
+static pid_t scanner_pid;
+
+// One scanner tick: walk every tracked allocation once
+static void scan_for_leaks() {
+    uint64_t start = get_timestamp_ns();
+    uint64_t start_cycles = agent_cycles();
+    int tracked = active_alloc_count;
+
+    printf("[SCANNER] Active allocations: %lu, Total memory: %.2f MB\n",
+           leak_buffer->total_allocations - leak_buffer->total_frees,
+           leak_buffer->current_memory / (1024.0*1024.0));
+
+    // Scan for potential leaks
+    int leaks_found = 0;
+    AGENT_PROBE1(scan_start, tracked);
+    for (int i = 0; i < active_alloc_count; i++) {
+        AllocationMeta* meta = active_allocs[i].meta;
+        void* user_ptr = active_allocs[i].address;
+
+        if (is_valid_allocation(meta) && is_potentially_leaked(meta)) {
+            report_leak(meta, user_ptr);
+            leaks_found++;
+        }
+    }
+
+    if (leaks_found > 0) {
+        printf("[SCANNER] 🔥 Found %d potential leaks!\n", leaks_found);
+    }
+
+    uint64_t elapsed = get_timestamp_ns() - start;
+    AGENT_PROBE3(scan_end, tracked, leaks_found, elapsed);
+    total_scan_ns += elapsed;
+    last_scan_tracked.store(tracked);
+    if (elapsed > max_scan_ns.load()) max_scan_ns.store(elapsed);
+    scan_count++;
+
+    // Publish the scan sample (and this thread's other samples) right away
+    agent_stats_record_call(PROBE_SCAN, agent_cycles() - start_cycles);
+    agent_stats_flush();
+}
+
+// Header totals for readers that don't sum the per-CPU slots. Only the
+// scanner thread writes them, so the seqlock needs no writer lock; it
+// keeps a snapshot from being torn, not the totals from being sampled at
+// slightly different instants (see HeaderSnapshot).
+static void publish_header_totals() {
+    LeakDetectionBuffer* buffer = leak_buffer;
+    if (!buffer) return;
+    uint64_t sums[NUM_CPU_COUNTERS];
+    percpu_sum_all(sums);
+
+    HeaderSnapshot* snap = &buffer->snapshot;
+    uint64_t seq = snap->seq;
+    __atomic_store_n(&snap->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    snap->total_allocations = sums[CTR_ALLOCATIONS];
+    snap->total_frees = sums[CTR_FREES];
+    snap->current_memory = sums[CTR_CURRENT_BYTES];
+    snap->leak_count = buffer->leak_count;
+    snap->events_written = (uint32_t)buffer->write_index;
+    snap->publish_ns = get_timestamp_ns();
+    buffer->total_allocations = sums[CTR_ALLOCATIONS];
+    buffer->total_frees = sums[CTR_FREES];
+    buffer->current_memory = sums[CTR_CURRENT_BYTES];
+    __atomic_store_n(&snap->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// Leak scanning thread function
+static void* leak_scanner_thread(void* arg) {
+    (void)arg;  // Unused
+
+    uint64_t last_tick = get_timestamp_ns();
+    while (scanner_running.load()) {
+        // Sleep in short steps so interval changes apply quickly
+        usleep(10000);
+        agent_stats_calibrate();
+        publish_header_totals();
+        site_sketch_resolve();
+        site_age_advance(get_timestamp_ns());
+        site_trend_tick(get_timestamp_ns());
+        changepoint_tick(get_timestamp_ns());
+        topk_tick(get_timestamp_ns());
+        site_rates_tick(get_timestamp_ns());
+
+        uint64_t interval = scan_interval_ms.load();
+        if (interval == 0 || get_timestamp_ns() - last_tick < interval * 1000000ULL) {
+            continue;
+        }
+        last_tick = get_timestamp_ns();
+
+        if (leak_buffer) {
+            scan_for_leaks();
+            publish_header_totals();  // new leak_count right away
+        }
+    }
+
+    return nullptr;
+}
+
+// Set scanner period (default 5s); 0 pauses scanning
+extern "C" void set_scan_interval_ms(uint64_t ms) {
+    scan_interval_ms.store(ms);
+}
+
+// Scanner cost: number of ticks, total/max tick duration, tracked set size
+extern "C" void get_scanner_stats(uint64_t* scans, uint64_t* total_ns, uint64_t* max_ns, uint64_t* tracked) {
+    if (scans) *scans = scan_count.load();
+    if (total_ns) *total_ns = total_scan_ns.load();
+    if (max_ns) *max_ns = max_scan_ns.load();
+    if (tracked) *tracked = last_scan_tracked.load();
+}
+
+// Restart the max tick duration, so callers can measure it per phase
+extern "C" void reset_scanner_max_ns() {
+    max_scan_ns.store(0);
+}
+
+// Set staleness threshold
+extern "C" void set_staleness_threshold_seconds(double seconds) {
+    staleness_threshold_ns.store((uint64_t)(seconds * 1e9));
+    printf("[AGENT] Staleness threshold set to %.2f seconds\n", seconds);
+}
+
+// Get current statistics
+extern "C" void get_allocation_stats(uint64_t* allocs, uint64_t* frees, uint64_t* current_mem) {
+    if (allocs) *allocs = percpu_sum(CTR_ALLOCATIONS);
+    if (frees) *frees = percpu_sum(CTR_FREES);
+    if (current_mem) *current_mem = percpu_sum(CTR_CURRENT_BYTES);
+}
+
+// Memory cost of this tracking design, for the overhead benchmark:
+// per-allocation header and registry entry, fixed registry and shm sizes
+extern "C" void get_agent_memory_layout(uint64_t* header_bytes, uint64_t* registry_entry_bytes,
+                                        uint64_t* registry_fixed_bytes, uint64_t* shm_bytes) {
+    if (header_bytes) *header_bytes = sizeof(AllocationMeta);
+    if (registry_entry_bytes) *registry_entry_bytes = sizeof(active_allocs[0]);
+    if (registry_fixed_bytes) *registry_fixed_bytes = sizeof(active_allocs);
+    if (shm_bytes) *shm_bytes = leak_buffer ? sizeof(LeakDetectionBuffer) : 0;
+}
+
+// Initialize advanced agent
+__attribute__((constructor))
+void advanced_agent_init() {
+    printf("[ADVANCED AGENT] Initializing with O(1) leak detection...\n");
+    
+    // Initialize function pointers
+    real_malloc = (void*(*)(size_t))dlsym(RTLD_NEXT, "malloc");
+    real_free = (void(*)(void*))dlsym(RTLD_NEXT, "free");
+    real_realloc = (void*(*)(void*, size_t))dlsym(RTLD_NEXT, "realloc");
+    real_calloc = (void*(*)(size_t, size_t))dlsym(RTLD_NEXT, "calloc");
+    
+    // Create shared memory for leak detection
+    shm_fd = shm_open(ADVANCED_SHM_NAME, O_CREAT | O_RDWR, 0666);
+    if (shm_fd != -1) {
+        if (ftruncate(shm_fd, sizeof(LeakDetectionBuffer)) == -1) {
+            perror("ftruncate");
+            close(shm_fd);
+            return;
+        }
+        leak_buffer = (LeakDetectionBuffer*)mmap(0, sizeof(LeakDetectionBuffer),
+                                               PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+        
+        if (leak_buffer != MAP_FAILED) {
+            // Initialize the buffer properly
+            leak_buffer->write_index = 0;
+            leak_buffer->read_index = 0;
+            leak_buffer->total_allocations = 0;
+            leak_buffer->total_frees = 0;
+            leak_buffer->current_memory = 0;
+            leak_buffer->leak_count = 0;
+            
+            // Zero-initialize events array
+            for (int i = 0; i < LEAK_BUFFER_SIZE; i++) {
+                leak_buffer->events[i] = {};
+            }
+            memset(&leak_buffer->stats, 0, sizeof(leak_buffer->stats));
+            agent_stats_init(&leak_buffer->stats);
+            memset(&leak_buffer->alloc_profile, 0, sizeof(leak_buffer->alloc_profile));
+            leak_buffer->alloc_profile.magic = ALLOC_PROFILE_MAGIC;
+            memset(&leak_buffer->snapshot, 0, sizeof(leak_buffer->snapshot));
+            leak_buffer->snapshot.pid = (uint32_t)getpid();
+            __atomic_store_n(&leak_buffer->snapshot.magic, HEADER_SNAPSHOT_MAGIC, __ATOMIC_RELEASE);
+            memset(&leak_buffer->size_hist, 0, sizeof(leak_buffer->size_hist));
+            size_hist_init(&leak_buffer->size_hist);
+            memset(&leak_buffer->sites, 0, sizeof(leak_buffer->sites));
+            site_sketch_init(&leak_buffer->sites);
+            memset(&leak_buffer->site_ages, 0, sizeof(leak_buffer->site_ages));
+            site_age_init(&leak_buffer->site_ages, get_timestamp_ns());
+            memset(&leak_buffer->top_sites, 0, sizeof(leak_buffer->top_sites));
+            topk_init(&leak_buffer->top_sites);
+            memset(&leak_buffer->site_rates, 0, sizeof(leak_buffer->site_rates));
+            site_rates_init(&leak_buffer->site_rates, get_timestamp_ns());
+            memset(&leak_buffer->site_trends, 0, sizeof(leak_buffer->site_trends));
+            site_trend_init(&leak_buffer->site_trends, get_timestamp_ns());
+            memset(&leak_buffer->change_points, 0, sizeof(leak_buffer->change_points));
+            changepoint_init(&leak_buffer->change_points, get_timestamp_ns());
+            printf("[ADVANCED AGENT] Shared memory created: %zu bytes\n", sizeof(LeakDetectionBuffer));
+        } else {
+            leak_buffer = nullptr;
+        }
+    }
+    
+    percpu_counters_init(leak_buffer ? &leak_buffer->cpu_counters : nullptr);
+    
+    // Detector configuration for runs that can't call the setters
+    // (LEAK_SCAN_INTERVAL_MS, LEAK_STALENESS_SECONDS)
+    if (const char* env = getenv("LEAK_SCAN_INTERVAL_MS")) {
+        set_scan_interval_ms(strtoull(env, nullptr, 10));
+    }
+    if (const char* env = getenv("LEAK_STALENESS_SECONDS")) {
+        set_staleness_threshold_seconds(atof(env));
+    }
+    if (const char* env = getenv("ALLOC_PROFILE")) {
+        const char* outlier = getenv("ALLOC_PROFILE_OUTLIER_US");
+        set_alloc_profiling(atoi(env), outlier ? atof(outlier) : 0);
+    }
+    if (const char* env = getenv("SITE_RATE_SKETCH")) {
+        const char* epsilon = getenv("SITE_RATE_EPSILON");
+        const char* delta = getenv("SITE_RATE_DELTA");
+        set_site_rate_sketch(atoi(env), epsilon ? atof(epsilon) : 0, delta ? atof(delta) : 0);
+    }
+    
+    // Start leak scanner thread
+    scanner_running.store(true);
+    if (pthread_create(&scanner_thread, nullptr, leak_scanner_thread, nullptr) == 0) {
+        scanner_pid = getpid();
+    } else {
+        scanner_running.store(false);
+    }
+    
+    printf("[ADVANCED AGENT] Initialization complete!\n");
+}
+
+// Cleanup
+__attribute__((destructor))
+void advanced_agent_cleanup() {
+    printf("[ADVANCED AGENT] Shutting down...\n");
+    printf("Final stats: %lu allocations, %lu frees, %lu bytes current\n",
+           percpu_sum(CTR_ALLOCATIONS), percpu_sum(CTR_FREES), percpu_sum(CTR_CURRENT_BYTES));
+    
+    // The scanner's ticks write through the pointers nulled below
+    if (scanner_running.exchange(false) && scanner_pid == getpid()) {
+        pthread_join(scanner_thread, nullptr);
+    }
+
+    if (leak_buffer) {
+        // Hooks keep running after this; stop them touching the segment
+        agent_stats_flush();
+        profile_flush();
+        topk_flush(true);
+        topk_drain_deferred(top_sites);
+        alloc_profiling = 0;
+        agent_stats_area = nullptr;
+        size_histograms = nullptr;
+        site_trends = nullptr;
+        change_points = nullptr;
+        site_age_table = nullptr;
+        top_sites = nullptr;
+        site_rates_enabled = 0;
+        site_rates = nullptr;
+        site_table = nullptr;
+        percpu_counters_detach();
+        LeakDetectionBuffer* buffer = leak_buffer;
+        leak_buffer = nullptr;
+        munmap(buffer, sizeof(LeakDetectionBuffer));
+        close(shm_fd);
+        shm_unlink(ADVANCED_SHM_NAME);
+    }
+}
@@ -22,6 +22,8 @@ from dataclasses import dataclass
 from collections import defaultdict, deque
 import threading
 
+from agent_stats import read_header_snapshot
+
 @dataclass
 class LeakEvent:
     event_id: int
@@ -123,8 +125,18 @@ class AdvancedLeakAnalyzer:
         write_index, read_index, total_allocs, total_frees, current_mem, leak_count = \
             self.buffer_header_struct.unpack(header_data)
         
+        # Aggregates from the snapshot when available: never torn mid-update
+        snapshot = self.read_header_snapshot()
+        if snapshot:
+            total_allocs, total_frees, current_mem, leak_count = snapshot
+        
         return write_index, read_index, total_allocs, total_frees, current_mem, leak_count
     
+    def read_header_snapshot(self) -> Optional[Tuple[int, int, int, int]]:
+        """Seqlock read of the header aggregates; None if unavailable or always mid-update"""
+        snapshot = read_header_snapshot(self.shm)
+        return snapshot[1:5] if snapshot else None
+    
     def read_leak_event(self, slot_index: int) -> Optional[LeakEvent]:
         """Read a single leak event from shared memory"""
         if not self.shm:
@@ -151,7 +163,7 @@ class AdvancedLeakAnalyzer:
             
             # Unpack event data based on type
             if event_type == self.EVENT_MALLOC or event_type == self.EVENT_FREE:
-                address, size, alloc_time, site_id = struct.unpack('<QqQI', data_bytes[:24])
+                address, size, alloc_time, site_id = struct.unpack('<QqQI', data_bytes[:28])
                 data = {
                     'address': address,
                     'size': size,
@@ -159,7 +171,7 @@ class AdvancedLeakAnalyzer:
                     'site_id': site_id
                 }
             elif event_type == self.EVENT_LEAK_DETECTED:
-                address, size, staleness_ns, site_id = struct.unpack('<QqQI', data_bytes[:24])
+                address, size, staleness_ns, site_id = struct.unpack('<QqQI', data_bytes[:28])
                 data = {
                     'address': address,
                     'size': size,
@@ -8,39 +8,39 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <cstdint> // Use fixed-size integers for cross-language compatibility
-
-// Data structure for shared memory using fixed-size types
-struct AllocationData {
-    int32_t malloc_count;
-    uint64_t size;
-    uint64_t total_bytes;
-    int64_t timestamp;
-    int32_t is_valid;  // 0=empty, 1=valid data
-} __attribute__((packed));
-
-#define BUFFER_SIZE 1000
-struct SharedBuffer {
-    // Moved indexes to the top to match Python analyzer's expectation
-    volatile int write_index;
-    volatile int read_index;
-    AllocationData allocations[BUFFER_SIZE];
-} __attribute__((packed));
+#include "shm_layout.h"
+#include "agent_stats.h"
+#include "agent_probes.h"
+#include "percpu_counters.h"
 
 // Global variables
 static void* (*real_malloc)(size_t) = NULL;
-static int malloc_count = 0;
-static size_t total_bytes_allocated = 0;
 static SharedBuffer* shared_buffer = NULL;
+
+// Running totals carried by the ring records are this thread's own
+// (exact, no shared cache line touched); process totals are the per-CPU
+// sums in shared_buffer->cpu_counters
+static __thread uint32_t thread_malloc_count __attribute__((tls_model("initial-exec")));
+static __thread uint64_t thread_malloc_bytes __attribute__((tls_model("initial-exec")));
 static int shm_fd = -1;
 
 void write_to_shared_memory(int count, size_t size, size_t total) {
     if (shared_buffer == NULL) return;
+    AgentProbeTimer timer(PROBE_PUBLISH);
 
     // Get the index for the new data.
     int next_slot = shared_buffer->write_index % BUFFER_SIZE;
+    if (next_slot == 0 && shared_buffer->write_index > 0) {
+        // Starting a new lap: unread records from the last one are overwritten
+        AGENT_PROBE2(ring_overflow, shared_buffer->write_index, shared_buffer->read_index);
+    }
 
-    // Prepare the data packet first.
-    AllocationData data = {count, size, total, time(NULL), 1};
+    // Prepare the data packet first. publish_ns lets consumers measure
+    // publish-to-consume latency on the shared monotonic clock.
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t publish_ns = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    AllocationData data = {count, size, total, time(NULL), 1, publish_ns};
 
     // Write the complete data structure to the buffer.
     shared_buffer->allocations[next_slot] = data;
@@ -56,12 +56,22 @@ void write_to_shared_memory(int count, size_t size, size_t total) {
     shared_buffer->write_index++;
 }
 
+// Memory cost of this agent for the overhead benchmark: no per-allocation
+// header or registry, only the shared ring
+extern "C" void get_agent_memory_layout(uint64_t* header_bytes, uint64_t* registry_entry_bytes,
+                                        uint64_t* registry_fixed_bytes, uint64_t* shm_bytes) {
+    if (header_bytes) *header_bytes = 0;
+    if (registry_entry_bytes) *registry_entry_bytes = 0;
+    if (registry_fixed_bytes) *registry_fixed_bytes = 0;
+    if (shm_bytes) *shm_bytes = shared_buffer ? sizeof(SharedBuffer) : 0;
+}
+
 __attribute__((constructor))
 void agent_start() {
     real_malloc = (void* (*)(size_t))dlsym(RTLD_NEXT, "malloc");
 
     // Create and map shared memory
-    shm_fd = shm_open("/ml_runtime_shm", O_CREAT | O_RDWR, 0666);
+    shm_fd = shm_open(BASIC_SHM_NAME, O_CREAT | O_RDWR, 0666);
     if (shm_fd != -1) {
         ftruncate(shm_fd, sizeof(SharedBuffer));
         shared_buffer = (SharedBuffer*)mmap(0, sizeof(SharedBuffer),
@@ -70,18 +80,26 @@ void agent_start() {
             // Initialize buffer - this will now correctly zero everything,
             // including the indexes at the start.
             memset(shared_buffer, 0, sizeof(SharedBuffer));
+            agent_stats_init(&shared_buffer->stats);
         } else {
             shared_buffer = NULL;
         }
     }
+    percpu_counters_init(shared_buffer ? &shared_buffer->cpu_counters : NULL);
 }
 
 __attribute__((destructor))
 void agent_stop() {
     if (shared_buffer != NULL) {
-        munmap(shared_buffer, sizeof(SharedBuffer));
+        // Hooks keep running after this; stop them touching the segment
+        agent_stats_flush();
+        agent_stats_area = NULL;
+        percpu_counters_detach();
+        SharedBuffer* buffer = shared_buffer;
+        shared_buffer = NULL;
+        munmap(buffer, sizeof(SharedBuffer));
         close(shm_fd);
-        shm_unlink("/ml_runtime_shm");
+        shm_unlink(BASIC_SHM_NAME);
     }
 }
 
@@ -90,17 +108,23 @@ extern "C" void* malloc(size_t size) {
     if (!real_malloc) {
         real_malloc = (void*(*)(size_t))dlsym(RTLD_NEXT, "malloc");
     }
+    AgentProbeTimer timer(PROBE_MALLOC_HOOK);
     
     // Chiama la malloc originale
     void* ptr = real_malloc(size);
     
     // Conta e stampa direttamente su stdout (niente file)
     if (ptr) {
-        malloc_count++;
-        total_bytes_allocated += size;
+        // Same signature as the advanced agent's probe; no call sites here
+        AGENT_PROBE3(malloc, ptr, size, 0);
+        percpu_add(CTR_ALLOCATIONS, 1);
+        percpu_add(CTR_BYTES_ALLOCATED, size);
+
+        thread_malloc_count++;
+        thread_malloc_bytes += size;
 
         // Write to shared memory instead of file
-        write_to_shared_memory(malloc_count, size, total_bytes_allocated);
+        write_to_shared_memory((int)thread_malloc_count, size, thread_malloc_bytes);
     }
     
     return ptr;
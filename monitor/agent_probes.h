@@ -0,0 +1,86 @@
+#pragma once
+
+// USDT (SystemTap-style) static probes for the agents' hot paths.
+//
+// A probe site is a single nop plus an ELF note (.note.stapsdt) naming it,
+// so it costs nothing until a tracer attaches to the live process:
+//
+//     perf probe -x ./advanced_agent.so sdt_ml_agent:malloc
+//     bpftrace -e 'usdt:./advanced_agent.so:ml_agent:leak_report { @[arg3] = count(); }'
+//
+// Provider is "ml_agent"; every argument is passed as a 64-bit value.
+// A probe name has the same arguments in every agent, so one script
+// works against either .so:
+//     malloc(ptr, size, site_id)        site_id is 0 in the basic agent
+//     free(ptr, size, site_id)          realloc(old_ptr, new_ptr, size)
+//     leak_report(ptr, size, staleness_ns, site_id)
+//     ring_overflow(write_index, read_index)
+//     scan_start(tracked)               scan_end(tracked, leaks, elapsed_ns)
+// Uses <sys/sdt.h> when available; otherwise emits the same note format
+// directly on x86-64. Build with -DAGENT_NO_PROBES to compile them out.
+
+#include <cstdint>
+
+#if defined(AGENT_NO_PROBES)
+
+#define AGENT_PROBE1(name, a) ((void)0)
+#define AGENT_PROBE2(name, a, b) ((void)0)
+#define AGENT_PROBE3(name, a, b, c) ((void)0)
+#define AGENT_PROBE4(name, a, b, c, d) ((void)0)
+
+#elif __has_include(<sys/sdt.h>)
+
+#include <sys/sdt.h>
+#define AGENT_PROBE1(name, a) DTRACE_PROBE1(ml_agent, name, (uint64_t)(a))
+#define AGENT_PROBE2(name, a, b) DTRACE_PROBE2(ml_agent, name, (uint64_t)(a), (uint64_t)(b))
+#define AGENT_PROBE3(name, a, b, c) DTRACE_PROBE3(ml_agent, name, (uint64_t)(a), (uint64_t)(b), (uint64_t)(c))
+#define AGENT_PROBE4(name, a, b, c, d) \
+    DTRACE_PROBE4(ml_agent, name, (uint64_t)(a), (uint64_t)(b), (uint64_t)(c), (uint64_t)(d))
+
+#elif defined(__x86_64__) && defined(__GNUC__)
+
+// Same layout sys/sdt.h emits: note type 3, "stapsdt", probe pc, base
+// address, semaphore (none), provider, name, "size@operand" argument list
+#define AGENT_PROBE_ASM_(name, args, ...)                                          \
+    __asm__ __volatile__("990: nop\n"                                              \
+                         ".pushsection .note.stapsdt,\"\",\"note\"\n"              \
+                         ".balign 4\n"                                             \
+                         ".4byte 992f-991f, 994f-993f, 3\n"                        \
+                         "991: .asciz \"stapsdt\"\n"                               \
+                         "992: .balign 4\n"                                        \
+                         "993: .8byte 990b\n"                                      \
+                         ".8byte _.stapsdt.base\n"                                 \
+                         ".8byte 0\n"                                              \
+                         ".asciz \"ml_agent\"\n"                                   \
+                         ".asciz \"" #name "\"\n"                                  \
+                         ".asciz \"" args "\"\n"                                   \
+                         "994: .balign 4\n"                                        \
+                         ".popsection\n"                                           \
+                         ".ifndef _.stapsdt.base\n"                                \
+                         ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+                         ".weak _.stapsdt.base\n"                                  \
+                         ".hidden _.stapsdt.base\n"                                \
+                         "_.stapsdt.base: .space 1\n"                              \
+                         ".size _.stapsdt.base, 1\n"                               \
+                         ".popsection\n"                                           \
+                         ".endif\n"                                                \
+                         :                                                         \
+                         : __VA_ARGS__)
+
+#define AGENT_PROBE_ARG_(x) "nor"((uint64_t)(x))
+#define AGENT_PROBE1(name, a) AGENT_PROBE_ASM_(name, "8@%0", AGENT_PROBE_ARG_(a))
+#define AGENT_PROBE2(name, a, b) AGENT_PROBE_ASM_(name, "8@%0 8@%1", AGENT_PROBE_ARG_(a), AGENT_PROBE_ARG_(b))
+#define AGENT_PROBE3(name, a, b, c) \
+    AGENT_PROBE_ASM_(name, "8@%0 8@%1 8@%2", AGENT_PROBE_ARG_(a), AGENT_PROBE_ARG_(b), AGENT_PROBE_ARG_(c))
+#define AGENT_PROBE4(name, a, b, c, d)                                                                   \
+    AGENT_PROBE_ASM_(name, "8@%0 8@%1 8@%2 8@%3", AGENT_PROBE_ARG_(a), AGENT_PROBE_ARG_(b), \
+                     AGENT_PROBE_ARG_(c), AGENT_PROBE_ARG_(d))
+
+#else
+
+#define AGENT_PROBE1(name, a) ((void)0)
+#define AGENT_PROBE2(name, a, b) ((void)0)
+#define AGENT_PROBE3(name, a, b, c) ((void)0)
+#define AGENT_PROBE4(name, a, b, c, d) ((void)0)
+
+#endif
@@ -0,0 +1,158 @@
+#pragma once
+
+// Agent self-instrumentation: per-thread log2 histograms of the cycles
+// spent in each probe, folded into the shared AgentStats area.
+//
+// Every call is counted; one call in 2^sample_shift per probe and thread
+// is timed (AGENT_STATS_SAMPLE_SHIFT, default 4), which keeps the timer
+// reads off most calls. Counts accumulate thread-locally and are added
+// to shm with relaxed atomics every AGENT_STATS_FLUSH_EVERY calls, so the
+// hot path never touches shared cache lines. A reader sees totals that
+// lag by at most that many calls per thread; calls still pending when a
+// thread exits are lost. Reader: agent_stats.py.
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cstdint>
+#include "shm_layout.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define AGENT_STATS_FLUSH_EVERY 256
+#define AGENT_STATS_DEFAULT_SHIFT 4
+
+static inline uint64_t agent_monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline uint64_t agent_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return agent_monotonic_ns();
+#endif
+}
+
+struct LocalHistogram {
+    uint64_t count;
+    uint64_t samples;
+    uint64_t total_cycles;
+    uint64_t max_cycles;
+    uint64_t buckets[AGENT_HIST_BUCKETS];
+};
+
+// initial-exec: no __tls_get_addr (which may malloc) inside the hooks
+static __thread LocalHistogram agent_local_hist[NUM_AGENT_PROBES] __attribute__((tls_model("initial-exec")));
+static __thread uint32_t agent_local_pending __attribute__((tls_model("initial-exec")));
+
+static AgentStats* agent_stats_area = nullptr;
+static uint64_t agent_stats_sample_mask = (1ULL << AGENT_STATS_DEFAULT_SHIFT) - 1;
+static uint64_t agent_stats_tsc0 = 0, agent_stats_ns0 = 0;
+
+static inline int agent_hist_bucket(uint64_t cycles) {
+    int b = 63 - __builtin_clzll(cycles | 1);
+    return b < AGENT_HIST_BUCKETS ? b : AGENT_HIST_BUCKETS - 1;
+}
+
+// Cycle rate measured against CLOCK_MONOTONIC since init
+static inline void agent_stats_calibrate() {
+    uint64_t ns = agent_monotonic_ns() - agent_stats_ns0;
+    if (agent_stats_area && ns > 1000000) {
+        agent_stats_area->cycles_per_sec = (uint64_t)((agent_cycles() - agent_stats_tsc0) * 1e9 / ns);
+    }
+}
+
+// For a threshold set in time units now: waits out the rest of the
+// first 1 ms since init if needed, so the rate is usable right away
+static inline void agent_stats_calibrate_now() {
+    while (agent_stats_area && agent_monotonic_ns() - agent_stats_ns0 < 1100000) {
+    }
+    agent_stats_calibrate();
+}
+
+// Timed call into a thread-local histogram
+static inline void agent_hist_sample(LocalHistogram& local, uint64_t cycles) {
+    local.samples++;
+    local.total_cycles += cycles;
+    if (cycles > local.max_cycles) local.max_cycles = cycles;
+    local.buckets[agent_hist_bucket(cycles)]++;
+}
+
+// Adds a thread-local histogram to its shared one and clears it
+static inline void agent_hist_merge(AgentHistogram& shared, LocalHistogram& local) {
+    if (!local.count && !local.samples) return;
+    __atomic_fetch_add(&shared.count, local.count, __ATOMIC_RELAXED);
+    if (local.samples) {
+        __atomic_fetch_add(&shared.samples, local.samples, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&shared.total_cycles, local.total_cycles, __ATOMIC_RELAXED);
+        uint64_t max = __atomic_load_n(&shared.max_cycles, __ATOMIC_RELAXED);
+        while (local.max_cycles > max &&
+               !__atomic_compare_exchange_n(&shared.max_cycles, &max, local.max_cycles, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+        for (int b = 0; b < AGENT_HIST_BUCKETS; b++) {
+            if (local.buckets[b]) __atomic_fetch_add(&shared.buckets[b], local.buckets[b], __ATOMIC_RELAXED);
+        }
+    }
+    memset(&local, 0, sizeof(local));
+}
+
+// Adds this thread's pending counts to shm
+static inline void agent_stats_flush() {
+    agent_local_pending = 0;
+    if (!agent_stats_area) return;
+
+    for (int p = 0; p < NUM_AGENT_PROBES; p++) {
+        agent_hist_merge(agent_stats_area->probes[p], agent_local_hist[p]);
+    }
+    agent_stats_calibrate();
+}
+
+// Records one timed call
+static inline void agent_stats_record(int probe, uint64_t cycles) {
+    agent_hist_sample(agent_local_hist[probe], cycles);
+}
+
+// Counts and times one call of a rare probe (no sampling)
+static inline void agent_stats_record_call(int probe, uint64_t cycles) {
+    agent_local_hist[probe].count++;
+    agent_stats_record(probe, cycles);
+}
+
+// Called once the shm segment is mapped and zeroed
+static inline void agent_stats_init(AgentStats* area) {
+    unsigned shift = AGENT_STATS_DEFAULT_SHIFT;
+    if (const char* env = getenv("AGENT_STATS_SAMPLE_SHIFT")) {
+        shift = (unsigned)atoi(env);
+        if (shift > 20) shift = 20;
+    }
+    agent_stats_sample_mask = (1ULL << shift) - 1;
+    agent_stats_tsc0 = agent_cycles();
+    agent_stats_ns0 = agent_monotonic_ns();
+    area->num_probes = NUM_AGENT_PROBES;
+    area->sample_shift = shift;
+    agent_stats_area = area;
+
+    // No calibration here: that would delay every preloaded process. The
+    // cycle rate is set by the first flush (or agent_stats_calibrate_now)
+    // and refined by later ones.
+    __atomic_store_n(&area->magic, AGENT_STATS_MAGIC, __ATOMIC_RELEASE);
+}
+
+// Scope timer for one probe: counts the call, times a sample of them
+struct AgentProbeTimer {
+    int probe;
+    uint64_t start;
+    explicit AgentProbeTimer(int p) : probe(p), start(0) {
+        if ((agent_local_hist[p].count++ & agent_stats_sample_mask) == 0) start = agent_cycles();
+    }
+    ~AgentProbeTimer() {
+        if (start) agent_stats_record(probe, agent_cycles() - start);
+        if (++agent_local_pending >= AGENT_STATS_FLUSH_EVERY) agent_stats_flush();
+    }
+};
@@ -0,0 +1,861 @@
+#!/usr/bin/env python3
+"""
+Agent self-instrumentation reader
+=================================
+
+Prints how much time a live preloaded process spends inside the agent,
+from the AgentStats area at the end of the agent's shared memory segment
+(shm_layout.h): per probe call count, mean, p50/p99/max and total time.
+
+Every call is counted but only one in 2^sample_shift is timed, so mean,
+percentiles and total time are estimates from the timed sample.
+Percentiles come from log2 buckets: upper bounds within a factor of two.
+Counts lag the process by at most 256 calls per thread.
+
+--alloc adds the advanced agent's optional allocator profile (run the
+process with ALLOC_PROFILE=1): latency of the real malloc/free per size
+class and the sites whose calls exceeded the outlier threshold.
+
+Exact allocation totals are summed from the per-CPU counter slots that
+follow (CpuCounters); they are shown when the agent publishes them.
+
+--sizes merges the advanced agent's per-thread allocation/free size
+histograms (log2 with 4 linear sub-buckets) and prints the size
+distribution, what is still live per size range and fragmentation hints.
+
+--sites prints each allocation site's size and lifetime quantiles from the
+advanced agent's per-site sketches; with --json the sparse sketch bins
+are included, and sketch_merge.py adds dumps from several processes or
+hosts into one distribution per site.
+
+--ages shows, per site, the live allocations and bytes by age (<1s, 1-10s,
+10s-1m, 1-10m, 10m-1h, >1h) that the agent keeps up to date on every
+malloc/free; reading it is O(sites).
+
+--top reads the agent's heavy-hitters summary of the K sites with the
+most net live bytes, ranked by growth over the last window (O(K)).
+
+--rates queries the optional count-min sketch (SITE_RATE_SKETCH=1) for
+every site_id and lists sites whose allocation count over the sliding
+window clears the sketch's error bound, with estimated allocs/s and
+bytes/s (overestimates by at most the bound shown).
+
+--trend shows the agent's per-site growth trend: an EWMA of the live-byte
+growth rate with a lower confidence bound, fitted once per tick from the
+age wheel. Sites whose bound stayed above zero through the warm-up are
+flagged as growing.
+
+--changes lists the change points the agent detected (two-sided CUSUM
+on live-bytes growth and allocation rate, per process and per site), each
+with the estimated onset as a wall-clock time to match against deploys or
+traffic shifts.
+
+Usage: agent_stats.py [--agent basic|advanced] [--alloc] [--sizes] [--sites] [--ages] [--top] [--rates] [--trend] [--changes] [--interval SECONDS] [--json]
+"""
+
+import argparse
+import json
+import mmap
+import os
+import struct
+import sys
+import time
+
+AGENT_STATS_MAGIC = 0x53545441
+AGENT_HIST_BUCKETS = 48
+AGENT_MAX_PROBES = 8
+ALLOC_PROFILE_MAGIC = 0x464f5250
+ALLOC_SIZE_CLASSES = 16
+ALLOC_OUTLIER_SITES = 256
+ALLOC_OPS = ['malloc', 'free']
+PROBE_NAMES = ['malloc_hook', 'free_hook', 'publish', 'scan']
+
+# Segment layout (shm_layout.h). Every offset below is derived from the
+# sizes of the areas in front of it, mirroring the C structs, and
+# check_segment() compares the resulting total with the mapped file.
+SHM_PATHS = {
+    'basic': '/dev/shm/ml_runtime_shm',
+    'advanced': '/dev/shm/ml_advanced_leak_detection',
+}
+
+
+def pad_to_64(used):
+    """SHM_PAD_TO_64: bytes up to the next 64-byte boundary (a full line when already aligned)"""
+    return 64 - used % 64
+
+
+BASIC_HEADER = struct.Struct('<ii')            # write_index, read_index
+BASIC_RECORD = struct.Struct('<iQQqiQ')        # AllocationData
+BASIC_RING_SIZE = 1000                         # BUFFER_SIZE
+ADVANCED_HEADER = struct.Struct('<iiQQQI')     # write_index ... leak_count
+LEAK_EVENT = struct.Struct('<iIqI32sI')        # LeakEvent
+LEAK_RING_SIZE = 1000                          # LEAK_BUFFER_SIZE
+
+STATS_HEADER = struct.Struct('<IIQII')
+HISTOGRAM = struct.Struct(f'<QQQQ{AGENT_HIST_BUCKETS}Q')
+AGENT_STATS_SIZE = STATS_HEADER.size + AGENT_MAX_PROBES * HISTOGRAM.size
+# AgentStats follows the ring (and a 4-byte pad in the advanced segment)
+_BASIC_RING_END = BASIC_HEADER.size + BASIC_RING_SIZE * BASIC_RECORD.size
+_ADVANCED_RING_END = ADVANCED_HEADER.size + LEAK_RING_SIZE * LEAK_EVENT.size + 4
+SEGMENTS = {
+    'basic': (SHM_PATHS['basic'], _BASIC_RING_END),
+    'advanced': (SHM_PATHS['advanced'], _ADVANCED_RING_END),
+}
+
+PROFILE_HEADER = struct.Struct('<IIQQ')
+OUTLIER_SITE = struct.Struct('<IIIIQQQQ')
+# AllocatorProfile follows AgentStats in the advanced segment
+PROFILE_OFFSET = SEGMENTS['advanced'][1] + AGENT_STATS_SIZE
+ALLOC_PROFILE_SIZE = (PROFILE_HEADER.size + len(ALLOC_OPS) * ALLOC_SIZE_CLASSES * HISTOGRAM.size +
+                      ALLOC_OUTLIER_SITES * OUTLIER_SITE.size)
+
+CPU_COUNTERS_MAGIC = 0x55504350
+CPU_COUNTER_MODES = {1: 'rseq', 2: 'per-thread'}
+NUM_CPU_COUNTERS = 8
+CPU_COUNTER_SLOTS = 256 + 1  # AGENT_MAX_CPUS + overflow slot
+COUNTERS_HEADER = struct.Struct('<III52x')
+COUNTER_SLOT = struct.Struct(f'<{NUM_CPU_COUNTERS}Q')
+CPU_COUNTERS_SIZE = COUNTERS_HEADER.size + CPU_COUNTER_SLOTS * COUNTER_SLOT.size
+# CpuCounters: first 64-byte boundary past the previous area
+_BASIC_STATS_END = SEGMENTS['basic'][1] + AGENT_STATS_SIZE
+_ADVANCED_PROFILE_END = PROFILE_OFFSET + ALLOC_PROFILE_SIZE
+CPU_COUNTERS_OFFSET = {
+    'basic': _BASIC_STATS_END + pad_to_64(_BASIC_STATS_END),
+    'advanced': _ADVANCED_PROFILE_END + pad_to_64(_ADVANCED_PROFILE_END),
+}
+HEADER_SNAPSHOT_MAGIC = 0x50414e53
+HEADER_SNAPSHOT = struct.Struct('<IIQQQQQQQ')
+# HeaderSnapshot follows the per-CPU counters in the advanced segment
+HEADER_SNAPSHOT_OFFSET = CPU_COUNTERS_OFFSET['advanced'] + CPU_COUNTERS_SIZE
+SIZE_HIST_MAGIC = 0x54534948
+SIZE_HIST_BUCKETS = 192
+SIZE_HIST_SLOTS = 32 + 1
+SIZE_HIST_HEADER = struct.Struct('<IIIII44x')
+# SizeHistograms follows the header snapshot in the advanced segment
+SIZE_HIST_OFFSET = HEADER_SNAPSHOT_OFFSET + HEADER_SNAPSHOT.size
+SIZE_HIST_SIZE = SIZE_HIST_HEADER.size + SIZE_HIST_SLOTS * len(ALLOC_OPS) * SIZE_HIST_BUCKETS * 8
+SITE_SKETCH_MAGIC = 0x48434b53
+SITE_SKETCH_BINS = 160
+SITE_TABLE_SIZE = 256
+SITE_TABLE_HEADER = struct.Struct('<IIIIQ40x')
+SITE_ENTRY_HEADER = struct.Struct('<IIQQ32s')
+QUANTILE_SKETCH_SIZE = 16 + 4 * SITE_SKETCH_BINS
+# SiteTable follows the size histograms in the advanced segment
+SITE_TABLE_OFFSET = SIZE_HIST_OFFSET + SIZE_HIST_SIZE
+SITE_TABLE_BYTES = SITE_TABLE_HEADER.size + SITE_TABLE_SIZE * (SITE_ENTRY_HEADER.size + 2 * QUANTILE_SKETCH_SIZE)
+SITE_AGE_MAGIC = 0x45474153
+SITE_AGE_SLOTS = 41
+SITE_AGE_HEADER = struct.Struct('<IIQQ40x')
+SITE_AGES = struct.Struct(f'<{SITE_AGE_SLOTS}q{SITE_AGE_SLOTS}q')
+# SiteAgeTable follows the site table in the advanced segment
+SITE_AGE_OFFSET = SITE_TABLE_OFFSET + SITE_TABLE_BYTES
+SITE_AGE_BYTES = SITE_AGE_HEADER.size + SITE_TABLE_SIZE * SITE_AGES.size
+AGE_BUCKETS = ['<1s', '1-10s', '10s-1m', '1-10m', '10m-1h', '>1h']
+OLD_AGE_BUCKETS = AGE_BUCKETS[2:]  # "old live bytes": a minute and up
+TOPK_MAGIC = 0x4b504f54
+TOPK_SITES = 32
+TOPK_HEADER = struct.Struct('<IIIIQQQQ16x')
+TOPK_ENTRY = struct.Struct('<IIqqqqQ')
+# TopKSites follows the site age table in the advanced segment
+TOPK_OFFSET = SITE_AGE_OFFSET + SITE_AGE_BYTES
+TOPK_BYTES = TOPK_HEADER.size + TOPK_SITES * TOPK_ENTRY.size
+CMS_MAGIC = 0x4b534d43
+CMS_MAX_DEPTH = 4
+CMS_MAX_WIDTH = 1024
+CMS_WINDOWS = 6
+CMS_HEADER = struct.Struct(f'<IIIIIIQ{CMS_WINDOWS}Qdd{CMS_MAX_DEPTH}Q')
+# CountMinSketch follows the top-K summary in the advanced segment
+CMS_OFFSET = TOPK_OFFSET + TOPK_BYTES
+CMS_BYTES = CMS_HEADER.size + CMS_WINDOWS * CMS_MAX_DEPTH * CMS_MAX_WIDTH * (4 + 8)
+SITE_ID_SPACE = 1 << 16  # site_id is a 16-bit hash of the call site
+TREND_MAGIC = 0x444e5254
+TREND_HEADER = struct.Struct('<IIQQQddII8x')
+TREND_ENTRY = struct.Struct('<qqdddIIQ')
+# SiteTrendTable follows the count-min sketch in the advanced segment
+TREND_OFFSET = CMS_OFFSET + CMS_BYTES
+TREND_BYTES = TREND_HEADER.size + SITE_TABLE_SIZE * TREND_ENTRY.size
+CHANGEPOINT_MAGIC = 0x544e5043
+CHANGEPOINT_HEADER = struct.Struct('<IIQQQdddII')
+CUSUM_STATE = struct.Struct('<qddddddIIQQIIQ')
+CHANGE_ALERT = struct.Struct('<IIiIQQdd')
+CHANGEPOINT_ALERTS = 64
+CP_PROCESS_SITE = 0xffffffff
+CP_SERIES_NAMES = ('live_bytes_growth', 'alloc_rate')
+CP_SERIES = len(CP_SERIES_NAMES)
+# ChangePointTable follows the site trends in the advanced segment
+CHANGEPOINT_OFFSET = TREND_OFFSET + TREND_BYTES
+CHANGEPOINT_BYTES = (CHANGEPOINT_HEADER.size + (1 + SITE_TABLE_SIZE) * CP_SERIES * CUSUM_STATE.size +
+                     CHANGEPOINT_ALERTS * CHANGE_ALERT.size)
+# sizeof(SharedBuffer) and sizeof(LeakDetectionBuffer)
+SEGMENT_SIZE = {
+    'basic': CPU_COUNTERS_OFFSET['basic'] + CPU_COUNTERS_SIZE,
+    'advanced': CHANGEPOINT_OFFSET + CHANGEPOINT_BYTES,
+}
+COUNTER_NAMES = {
+    'basic': {'allocations': 0, 'bytes_allocated': 2},
+    'advanced': {'allocations': 0, 'frees': 1, 'current_bytes': 3},
+}
+
+
+def check_segment(fd, agent):
+    """None if the segment behind fd has the size this layout expects, else the reason it doesn't"""
+    size = os.fstat(fd).st_size
+    if size != SEGMENT_SIZE[agent]:
+        return (f"{SHM_PATHS[agent]} is {size} bytes, this reader expects {SEGMENT_SIZE[agent]}: "
+                f"the agent and agent_stats.py disagree on shm_layout.h")
+    return None
+
+
+def read_agent_stats(shm, offset):
+    """Returns (cycles_per_sec, sample_shift, {probe: (count, samples, total, max, buckets)}) or None"""
+    if len(shm) < offset + STATS_HEADER.size:
+        return None
+    magic, num_probes, cycles_per_sec, sample_shift, _ = STATS_HEADER.unpack_from(shm, offset)
+    if magic != AGENT_STATS_MAGIC:
+        return None
+    probes = {}
+    pos = offset + STATS_HEADER.size
+    for i in range(num_probes):
+        values = HISTOGRAM.unpack_from(shm, pos + i * HISTOGRAM.size)
+        name = PROBE_NAMES[i] if i < len(PROBE_NAMES) else f'probe_{i}'
+        probes[name] = (values[0], values[1], values[2], values[3], values[4:])
+    return cycles_per_sec, sample_shift, probes
+
+
+def size_class_label(c):
+    lo = 0 if c == 0 else 1 << (c + 4)
+    if c == ALLOC_SIZE_CLASSES - 1:
+        return f'>={lo}'
+    return f'{lo}-{(1 << (c + 5)) - 1}'
+
+
+def read_alloc_profile(shm):
+    """Returns (enabled, outlier_cycles, overflow, {(op, class): histogram}, [outlier sites]) or None"""
+    if len(shm) < PROFILE_OFFSET + PROFILE_HEADER.size:
+        return None
+    magic, enabled, outlier_cycles, overflow = PROFILE_HEADER.unpack_from(shm, PROFILE_OFFSET)
+    if magic != ALLOC_PROFILE_MAGIC:
+        return None
+    pos = PROFILE_OFFSET + PROFILE_HEADER.size
+    classes = {}
+    for op in range(len(ALLOC_OPS)):
+        for c in range(ALLOC_SIZE_CLASSES):
+            values = HISTOGRAM.unpack_from(shm, pos)
+            pos += HISTOGRAM.size
+            if values[0]:
+                classes[(ALLOC_OPS[op], size_class_label(c))] = (values[0], values[1], values[2], values[3],
+                                                                 values[4:])
+    sites = []
+    for i in range(ALLOC_OUTLIER_SITES):
+        key, site_id, op, _, count, total, max_cycles, max_size = \
+            OUTLIER_SITE.unpack_from(shm, pos + i * OUTLIER_SITE.size)
+        if key:
+            sites.append({'site_id': site_id, 'op': ALLOC_OPS[op], 'count': count,
+                          'total_cycles': total, 'max_cycles': max_cycles, 'max_size': max_size})
+    sites.sort(key=lambda site: site['total_cycles'], reverse=True)
+    return enabled, outlier_cycles, overflow, classes, sites
+
+
+def read_cpu_counters(shm, agent):
+    """Returns (mode, {counter: total}) summed over all slots, or None"""
+    offset = CPU_COUNTERS_OFFSET[agent]
+    if len(shm) < offset + COUNTERS_HEADER.size:
+        return None
+    magic, mode, num_slots = COUNTERS_HEADER.unpack_from(shm, offset)
+    if magic != CPU_COUNTERS_MAGIC:
+        return None
+    totals = [0] * NUM_CPU_COUNTERS
+    pos = offset + COUNTERS_HEADER.size
+    for i in range(num_slots):
+        for c, value in enumerate(COUNTER_SLOT.unpack_from(shm, pos + i * COUNTER_SLOT.size)):
+            totals[c] += value
+    # Slots wrap modulo 2^64; signed counters (current_bytes) come back as two's complement
+    totals = [t % (1 << 64) for t in totals]
+    totals = [t - (1 << 64) if t >= 1 << 63 else t for t in totals]
+    return CPU_COUNTER_MODES.get(mode, str(mode)), {name: totals[c] for name, c in COUNTER_NAMES[agent].items()}
+
+
+def read_header_snapshot(shm, retries=100):
+    """Seqlock read of the advanced agent's HeaderSnapshot, or None
+
+    Returns (pid, total_allocations, total_frees, current_memory,
+    leak_count, events_written, publish_ns). None when the segment doesn't
+    have this layout's size (agent built from another shm_layout.h), the
+    snapshot isn't initialized, or every retry
+    caught the scanner mid-update. The copy is never torn, but the totals
+    are sampled one after another (see HeaderSnapshot in shm_layout.h).
+    """
+    if len(shm) != SEGMENT_SIZE['advanced']:
+        return None
+    seq_offset = HEADER_SNAPSHOT_OFFSET + 8
+    for _ in range(retries):
+        seq_before = struct.unpack_from('<Q', shm, seq_offset)[0]
+        if seq_before & 1:
+            continue
+        magic, pid, seq, allocs, frees, current, leaks, events, publish_ns = \
+            HEADER_SNAPSHOT.unpack_from(shm, HEADER_SNAPSHOT_OFFSET)
+        if magic != HEADER_SNAPSHOT_MAGIC:
+            return None
+        if seq == seq_before == struct.unpack_from('<Q', shm, seq_offset)[0]:
+            # current_memory is a signed count stored in a uint64
+            current = current - (1 << 64) if current >> 63 else current
+            return pid, allocs, frees, current, leaks, events, publish_ns
+    return None
+
+
+def read_size_histograms(shm):
+    """Returns (sub_bits, allocs per bucket, frees per bucket) merged over all slots, or None"""
+    if len(shm) < SIZE_HIST_OFFSET + SIZE_HIST_HEADER.size:
+        return None
+    magic, num_slots, sub_bits, num_buckets, _ = SIZE_HIST_HEADER.unpack_from(shm, SIZE_HIST_OFFSET)
+    if magic != SIZE_HIST_MAGIC:
+        return None
+    row = struct.Struct(f'<{num_buckets}Q')
+    allocs, frees = [0] * num_buckets, [0] * num_buckets
+    pos = SIZE_HIST_OFFSET + SIZE_HIST_HEADER.size
+    for _ in range(num_slots):
+        for totals in (allocs, frees):
+            for b, n in enumerate(row.unpack_from(shm, pos)):
+                totals[b] += n
+            pos += row.size
+    return sub_bits, allocs, frees
+
+
+def size_bucket_range(b, sub_bits):
+    """[lo, hi) byte range of an HDR size bucket"""
+    sub = 1 << sub_bits
+    if b < sub:
+        return b, b + 1
+    e = (b - sub) // sub + sub_bits
+    lo = (sub + (b - sub) % sub) << (e - sub_bits)
+    return lo, lo + (1 << (e - sub_bits))
+
+
+def summarize_sizes(sub_bits, allocs, frees):
+    """Size percentiles, live objects per range and fragmentation hints"""
+    def percentile(q):
+        total = sum(allocs)
+        seen = 0
+        for b, n in enumerate(allocs):
+            seen += n
+            if total and seen >= q * total:
+                return size_bucket_range(b, sub_bits)[1] - 1
+        return 0
+
+    buckets = []
+    live_bytes = 0
+    for b, (a, f) in enumerate(zip(allocs, frees)):
+        if not a and not f:
+            continue
+        lo, hi = size_bucket_range(b, sub_bits)
+        live = max(a - f, 0)
+        live_bytes += live * (lo + hi - 1) // 2
+        buckets.append({'lo': lo, 'hi': hi - 1, 'allocs': a, 'frees': f, 'live': live})
+
+    live_total = sum(bk['live'] for bk in buckets)
+    small_live = sum(bk['live'] for bk in buckets if bk['hi'] < 256)
+    return {
+        'allocs': sum(allocs),
+        'frees': sum(frees),
+        'p50_bytes': percentile(0.50),
+        'p90_bytes': percentile(0.90),
+        'p99_bytes': percentile(0.99),
+        'live_objects': live_total,
+        'live_bytes_est': live_bytes,
+        # Many distinct live sizes, and small objects pinned among large ones,
+        # are what leaves holes the allocator can't reuse
+        'live_size_classes': sum(1 for bk in buckets if bk['live']),
+        'small_live_fraction': round(small_live / live_total, 3) if live_total else 0.0,
+        'buckets': buckets,
+    }
+
+
+def print_sizes(sizes):
+    if not sizes:
+        print("\n❌ No size histograms in this segment (advanced agent only)")
+        return
+    print(f"\n📐 Allocation sizes: {sizes['allocs']} allocs, {sizes['frees']} frees, "
+          f"p50 {sizes['p50_bytes']} B, p90 {sizes['p90_bytes']} B, p99 {sizes['p99_bytes']} B")
+    print(f"   live: {sizes['live_objects']} objects, ~{sizes['live_bytes_est'] / 1024:.1f} KB in "
+          f"{sizes['live_size_classes']} size classes ({sizes['small_live_fraction'] * 100:.0f}% under 256 B)")
+    print(f"{'size':>21} {'allocs':>12} {'frees':>12} {'live':>10}")
+    for bk in sizes['buckets']:
+        print(f"{bk['lo']:>10}-{bk['hi']:<10} {bk['allocs']:>12} {bk['frees']:>12} {bk['live']:>10}")
+
+
+def read_site_sketches(shm):
+    """Returns (sub_bits, overflow, [site dicts with sparse size/lifetime sketches]) or None"""
+    if len(shm) < SITE_TABLE_OFFSET + SITE_TABLE_HEADER.size:
+        return None
+    magic, num_sites, sub_bits, num_bins, overflow = SITE_TABLE_HEADER.unpack_from(shm, SITE_TABLE_OFFSET)
+    if magic != SITE_SKETCH_MAGIC:
+        return None
+    sketch = struct.Struct(f'<QQ{num_bins}I')
+    entry_size = SITE_ENTRY_HEADER.size + 2 * sketch.size
+    sites = []
+    for i in range(num_sites):
+        pos = SITE_TABLE_OFFSET + SITE_TABLE_HEADER.size + i * entry_size
+        key, site_id, caller, module_offset, module = SITE_ENTRY_HEADER.unpack_from(shm, pos)
+        if not key:
+            continue
+        site = {'index': i, 'site_id': site_id, 'module': module.split(b'\0', 1)[0].decode(errors='replace'),
+                'module_offset': module_offset}
+        pos += SITE_ENTRY_HEADER.size
+        for name in ('size', 'lifetime_us'):
+            count, total, *bins = sketch.unpack_from(shm, pos)
+            site[name] = {'count': count, 'sum': total, 'bins': {b: n for b, n in enumerate(bins) if n}}
+            pos += sketch.size
+        sites.append(site)
+    return sub_bits, overflow, sites
+
+
+def age_bucket_of_slot(slot, epoch_sec):
+    """Age bucket of a SiteAges slot (shm_layout.h): 1 s cohorts, then one bucket per level"""
+    if slot < 12:
+        # The 1 s cohort in this slot is the one within [epoch - 10, epoch + 1]
+        cohort = epoch_sec + 1 - (epoch_sec + 1 - slot) % 12
+        return 0 if cohort >= epoch_sec else 1
+    if slot < 20:
+        return 2
+    if slot < 32:
+        return 3
+    if slot < 40:
+        return 4
+    return 5
+
+
+def read_site_ages(shm, sites):
+    """Adds 'ages' {bucket: (count, bytes)} to each site dict; returns epoch_sec or None"""
+    if len(shm) < SITE_AGE_OFFSET + SITE_AGE_HEADER.size:
+        return None
+    magic, _, _, epoch_sec = SITE_AGE_HEADER.unpack_from(shm, SITE_AGE_OFFSET)
+    if magic != SITE_AGE_MAGIC:
+        return None
+    buckets = [age_bucket_of_slot(slot, epoch_sec) for slot in range(SITE_AGE_SLOTS)]
+    for site in sites:
+        values = SITE_AGES.unpack_from(shm, SITE_AGE_OFFSET + SITE_AGE_HEADER.size + site['index'] * SITE_AGES.size)
+        ages = {name: [0, 0] for name in AGE_BUCKETS}
+        for slot in range(SITE_AGE_SLOTS):
+            ages[AGE_BUCKETS[buckets[slot]]][0] += values[slot]
+            ages[AGE_BUCKETS[buckets[slot]]][1] += values[SITE_AGE_SLOTS + slot]
+        site['ages'] = {name: tuple(v) for name, v in ages.items()}
+    return epoch_sec
+
+
+def print_ages(site_sketches, epoch_sec, limit=30):
+    if not site_sketches or epoch_sec is None:
+        print("\n❌ No site age table in this segment (advanced agent only)")
+        return
+    sites = site_sketches[2]
+    old_bytes = lambda site: sum(site['ages'][name][1] for name in OLD_AGE_BUCKETS)
+    print(f"\n⏳ Live bytes by age per site (agent up {epoch_sec}s, sorted by bytes older than 1 min)")
+    print(f"{'site_id':>8} {'module+offset':<28} " + " ".join(f"{name:>10}" for name in AGE_BUCKETS))
+    for site in sorted(sites, key=old_bytes, reverse=True)[:limit]:
+        if not any(count for count, _ in site['ages'].values()):
+            continue
+        where = f"{site['module']}+{site['module_offset']:#x}" if site['module'] else '?'
+        print(f"{site['site_id']:>8} {where[:28]:<28} " +
+              " ".join(f"{site['ages'][name][1]:>10}" for name in AGE_BUCKETS))
+
+
+def read_top_sites(shm, retries=100):
+    """Seqlock copy of the top-K summary: (window_ns, evictions, dropped_bytes, [entries]) or None"""
+    if len(shm) < TOPK_OFFSET + TOPK_HEADER.size:
+        return None
+    for _ in range(retries):
+        magic, k, _, used, seq, window_ns, evictions, dropped = TOPK_HEADER.unpack_from(shm, TOPK_OFFSET)
+        if magic != TOPK_MAGIC:
+            return None
+        if seq & 1:
+            continue
+        entries = []
+        for i in range(min(used, k)):
+            site_id, _, live, error, mark, growth, inserted_ns = \
+                TOPK_ENTRY.unpack_from(shm, TOPK_OFFSET + TOPK_HEADER.size + i * TOPK_ENTRY.size)
+            entries.append({'site_id': site_id, 'live_bytes': live, 'error': error,
+                            'window_bytes': live - mark, 'growth_bytes': growth, 'inserted_ns': inserted_ns})
+        if TOPK_HEADER.unpack_from(shm, TOPK_OFFSET)[4] == seq:
+            entries.sort(key=lambda e: (e['growth_bytes'], e['live_bytes']), reverse=True)
+            return window_ns, evictions, dropped, entries
+    return None
+
+
+def print_top_sites(top):
+    if not top:
+        print("\n❌ No top-K summary in this segment (advanced agent only)")
+        return
+    window_ns, evictions, dropped, entries = top
+    print(f"\n🏆 Top sites by live-byte growth ({window_ns / 1e9:.0f}s window, {evictions} evictions)")
+    print(f"{'site_id':>8} {'growth':>12} {'this window':>12} {'live_bytes':>12} {'± error':>10}")
+    for e in entries:
+        print(f"{e['site_id']:>8} {e['growth_bytes']:>12} {e['window_bytes']:>12} {e['live_bytes']:>12} "
+              f"{e['error']:>10}")
+
+
+def read_site_rates(shm, now_ns=None):
+    """Heavy sites from the count-min sketch: (info, [sites]) or None if absent/disabled"""
+    if len(shm) < CMS_OFFSET + CMS_HEADER.size:
+        return None
+    fields = CMS_HEADER.unpack_from(shm, CMS_OFFSET)
+    magic, enabled, depth, width, windows, current, window_ns = fields[:7]
+    starts = fields[7:7 + windows]
+    epsilon, delta = fields[13:15]
+    seeds = fields[15:15 + depth]
+    if magic != CMS_MAGIC or not enabled:
+        return None
+    cells = windows * CMS_MAX_DEPTH * CMS_MAX_WIDTH
+    counts = struct.unpack_from(f'<{cells}I', shm, CMS_OFFSET + CMS_HEADER.size)
+    sizes = struct.unpack_from(f'<{cells}Q', shm, CMS_OFFSET + CMS_HEADER.size + 4 * cells)
+
+    # Sum the windows cell by cell: one sliding-window sketch
+    row_counts = [[0] * width for _ in range(depth)]
+    row_bytes = [[0] * width for _ in range(depth)]
+    for w in range(windows):
+        for r in range(depth):
+            base = (w * CMS_MAX_DEPTH + r) * CMS_MAX_WIDTH
+            rc, rb = row_counts[r], row_bytes[r]
+            for c in range(width):
+                rc[c] += counts[base + c]
+                rb[c] += sizes[base + c]
+    total = sum(row_counts[0])
+    now_ns = now_ns or time.monotonic_ns()
+    span = (now_ns - min(t for t in starts if t)) / 1e9 if any(starts) else 0
+    bound = epsilon * total
+    shift = 64 - (width.bit_length() - 1)
+    mask = (1 << 64) - 1
+
+    sites = []
+    for site_id in range(SITE_ID_SPACE):
+        key = site_id + 1
+        cols = [((key * seed) & mask) >> shift for seed in seeds]
+        count = min(row_counts[r][col] for r, col in enumerate(cols))
+        if count > bound and count:
+            nbytes = min(row_bytes[r][col] for r, col in enumerate(cols))
+            sites.append({'site_id': site_id, 'allocs': count, 'bytes': nbytes,
+                          'allocs_per_sec': round(count / span, 1) if span else 0,
+                          'bytes_per_sec': round(nbytes / span) if span else 0})
+    sites.sort(key=lambda site: site['bytes'], reverse=True)
+    info = {'depth': depth, 'width': width, 'epsilon': epsilon, 'delta': delta, 'window_s': round(span, 1),
+            'total_allocs': total, 'error_allocs': round(bound, 1)}
+    return info, sites
+
+
+def print_site_rates(rates, limit=30):
+    if not rates:
+        print("\n❌ Rate sketch disabled or missing (run the process with SITE_RATE_SKETCH=1)")
+        return
+    info, sites = rates
+    print(f"\n📈 Site allocation rates over {info['window_s']}s (count-min {info['depth']}x{info['width']}, "
+          f"+{info['error_allocs']:.0f} allocs at most, p={1 - info['delta']:.2f})")
+    print(f"{'site_id':>8} {'allocs':>12} {'allocs/s':>10} {'bytes/s':>12}")
+    for site in sites[:limit]:
+        print(f"{site['site_id']:>8} {site['allocs']:>12} {site['allocs_per_sec']:>10} {site['bytes_per_sec']:>12}")
+
+
+def read_site_trends(shm, sites, retries=100):
+    """Seqlock copy of the trend of each site in sites (read_site_sketches): (info, [trends]) or None"""
+    if len(shm) < TREND_OFFSET + TREND_HEADER.size:
+        return None
+    for _ in range(retries):
+        magic, num_sites, seq, tick_ns, _, alpha, z, warmup, flagged = TREND_HEADER.unpack_from(shm, TREND_OFFSET)
+        if magic != TREND_MAGIC:
+            return None
+        if seq & 1:
+            continue
+        trends = []
+        for site in sites:
+            live, _, rate, variance, lower, samples, rising, flagged_ns = \
+                TREND_ENTRY.unpack_from(shm, TREND_OFFSET + TREND_HEADER.size + site['index'] * TREND_ENTRY.size)
+            if samples < 2:
+                continue
+            trends.append({'site_id': site['site_id'], 'module': site['module'],
+                           'module_offset': site['module_offset'], 'live_bytes': live,
+                           'rate': round(rate, 1), 'stddev': round(variance ** 0.5, 1), 'lower': round(lower, 1),
+                           'rising_ticks': rising, 'flagged': bool(flagged_ns), 'flagged_ns': flagged_ns})
+        if TREND_HEADER.unpack_from(shm, TREND_OFFSET)[2] == seq:
+            trends.sort(key=lambda t: (t['flagged'], t['lower']), reverse=True)
+            info = {'tick_ns': tick_ns, 'alpha': alpha, 'z': z, 'warmup_ticks': warmup, 'flagged_sites': flagged}
+            return info, trends
+    return None
+
+
+def print_site_trends(trends, limit=20):
+    if not trends:
+        print("\n❌ No site trends in this segment (older agent build?)")
+        return
+    info, entries = trends
+    print(f"\n📉 Site growth trend (EWMA alpha={info['alpha']}, {info['z']} sigma, "
+          f"{info['tick_ns'] / 1e9:g}s ticks): {info['flagged_sites']} growing")
+    print(f"{'site_id':>8} {'module+offset':<28} {'live_bytes':>12} {'rate B/s':>11} {'lower B/s':>11} "
+          f"{'rising':>6}")
+    for t in entries[:limit]:
+        where = f"{t['module']}+{t['module_offset']:#x}" if t['module'] else '?'
+        mark = ' 🔥' if t['flagged'] else ''
+        print(f"{t['site_id']:>8} {where[:28]:<28} {t['live_bytes']:>12} {t['rate']:>11.0f} {t['lower']:>11.0f} "
+              f"{t['rising_ticks']:>6}{mark}")
+
+
+def read_change_points(shm, retries=100):
+    """Seqlock copy of the change-point alerts, oldest first: (info, [alerts]) or None"""
+    if len(shm) < CHANGEPOINT_OFFSET + CHANGEPOINT_HEADER.size:
+        return None
+    for _ in range(retries):
+        magic, num_sites, seq, tick_ns, _, alpha, k, h, warmup, written = \
+            CHANGEPOINT_HEADER.unpack_from(shm, CHANGEPOINT_OFFSET)
+        if magic != CHANGEPOINT_MAGIC:
+            return None
+        alerts_pos = CHANGEPOINT_OFFSET + CHANGEPOINT_HEADER.size + CUSUM_STATE.size * CP_SERIES * (1 + num_sites)
+        if seq & 1:
+            continue
+        now_ns, wall = time.monotonic_ns(), time.time()
+        alerts = []
+        for n in range(max(0, written - CHANGEPOINT_ALERTS), written):
+            series, site_id, direction, _, onset_ns, alarm_ns, before, after = \
+                CHANGE_ALERT.unpack_from(shm, alerts_pos + (n % CHANGEPOINT_ALERTS) * CHANGE_ALERT.size)
+            alerts.append({'series': CP_SERIES_NAMES[series],
+                           'site_id': None if site_id == CP_PROCESS_SITE else site_id,
+                           'direction': 'up' if direction > 0 else 'down',
+                           'onset_ns': onset_ns, 'alarm_ns': alarm_ns,
+                           'onset_time': round(wall - (now_ns - onset_ns) / 1e9, 3),
+                           'detection_delay_s': round((alarm_ns - onset_ns) / 1e9, 3),
+                           'before': round(before, 1), 'after': round(after, 1)})
+        if CHANGEPOINT_HEADER.unpack_from(shm, CHANGEPOINT_OFFSET)[2] == seq:
+            info = {'tick_ns': tick_ns, 'alpha': alpha, 'k': k, 'h': h, 'warmup_ticks': warmup,
+                    'alerts_written': written}
+            return info, alerts
+    return None
+
+
+def print_change_points(changes, limit=20):
+    if not changes:
+        print("\n❌ No change-point table in this segment (older agent build?)")
+        return
+    info, alerts = changes
+    print(f"\n⏱️  Change points (CUSUM k={info['k']}, h={info['h']}, {info['tick_ns'] / 1e9:g}s ticks): "
+          f"{info['alerts_written']} alerts")
+    print(f"{'onset':<23} {'delay':>7} {'where':>12} {'series':<18} {'dir':<4} {'before/s':>12} {'after/s':>12}")
+    for a in alerts[-limit:]:
+        onset = time.strftime('%Y-%m-%d %H:%M:%S', time.localtime(a['onset_time']))
+        onset += f".{int(a['onset_time'] * 1000) % 1000:03d}"
+        where = 'process' if a['site_id'] is None else f"site {a['site_id']}"
+        print(f"{onset:<23} {a['detection_delay_s']:>6.1f}s {where:>12} {a['series']:<18} {a['direction']:<4} "
+              f"{a['before']:>12.0f} {a['after']:>12.0f}")
+
+
+def sketch_quantile(sketch, q, sub_bits):
+    """q-quantile of a sparse sketch, as the midpoint of the bin holding it"""
+    total = sum(sketch['bins'].values())
+    if not total:
+        return 0
+    seen = 0
+    for b in sorted(sketch['bins']):
+        seen += sketch['bins'][b]
+        if seen >= q * total:
+            lo, hi = size_bucket_range(b, sub_bits)
+            return (lo + hi - 1) / 2
+    return 0
+
+
+def print_sites(site_sketches, limit=30):
+    if not site_sketches:
+        print("\n❌ No site sketches in this segment (advanced agent only)")
+        return
+    sub_bits, overflow, sites = site_sketches
+    print(f"\n📍 Sites by allocations ({len(sites)} tracked{f', {overflow} calls dropped' if overflow else ''})")
+    print(f"{'site_id':>8} {'module+offset':<28} {'allocs':>9} {'size p50':>9} {'p99':>9} "
+          f"{'frees':>9} {'life p50':>10} {'p99':>10}")
+    for site in sorted(sites, key=lambda s: s['size']['count'], reverse=True)[:limit]:
+        where = f"{site['module']}+{site['module_offset']:#x}" if site['module'] else '?'
+        size, life = site['size'], site['lifetime_us']
+        print(f"{site['site_id']:>8} {where[:28]:<28} {size['count']:>9} "
+              f"{sketch_quantile(size, 0.5, sub_bits):>9.0f} {sketch_quantile(size, 0.99, sub_bits):>9.0f} "
+              f"{life['count']:>9} {format_us(sketch_quantile(life, 0.5, sub_bits)):>10} "
+              f"{format_us(sketch_quantile(life, 0.99, sub_bits)):>10}")
+
+
+def format_us(us):
+    if us >= 1e6:
+        return f"{us / 1e6:.1f}s"
+    if us >= 1e3:
+        return f"{us / 1e3:.1f}ms"
+    return f"{us:.0f}us"
+
+
+def bucket_percentile(buckets, q):
+    """Upper bound (in cycles) of the bucket holding the q-quantile"""
+    total = sum(buckets)
+    if not total:
+        return 0
+    target = q * total
+    seen = 0
+    for i, n in enumerate(buckets):
+        seen += n
+        if seen >= target:
+            return 2 ** (i + 1)
+    return 2 ** len(buckets)
+
+
+def summarize(cycles_per_sec, probes):
+    scale = 1e9 / cycles_per_sec if cycles_per_sec else 1.0  # cycles -> ns
+    summary = {}
+    for name, (count, samples, total, max_cycles, buckets) in probes.items():
+        mean = total / samples * scale if samples else 0
+        summary[name] = {
+            'count': count,
+            'samples': samples,
+            'mean_ns': round(mean, 1),
+            'p50_ns': round(bucket_percentile(buckets, 0.50) * scale),
+            'p99_ns': round(bucket_percentile(buckets, 0.99) * scale),
+            'max_ns': round(max_cycles * scale),
+            'total_ms': round(mean * count / 1e6, 3),
+        }
+    return summary
+
+
+def print_alloc_profile(profile, cycles_per_sec, scale):
+    if not profile:
+        print("\n❌ No allocator profile in this segment (advanced agent only)")
+        return
+    enabled, outlier_cycles, overflow, classes, sites = profile
+    print(f"\n⏱️  Real allocator latency ({'enabled' if enabled else 'disabled: run with ALLOC_PROFILE=1'}, "
+          f"outliers > {outlier_cycles * scale / 1000:.1f} us)")
+    print(f"{'op':<7} {'size':>16} {'count':>10} {'mean_ns':>9} {'p50_ns':>9} {'p99_ns':>9} {'max_ns':>11}")
+    for (op, size), s in summarize(cycles_per_sec, classes).items():
+        print(f"{op:<7} {size:>16} {s['count']:>10} {s['mean_ns']:>9} {s['p50_ns']:>9} "
+              f"{s['p99_ns']:>9} {s['max_ns']:>11}")
+    if sites:
+        print(f"\n🔥 Outlier sites (by total time{f', {overflow} dropped' if overflow else ''}):")
+        print(f"{'site_id':>8} {'op':<7} {'count':>8} {'total_us':>10} {'max_us':>9} {'max_size':>10}")
+        for site in sites[:20]:
+            print(f"{site['site_id']:>8} {site['op']:<7} {site['count']:>8} "
+                  f"{site['total_cycles'] * scale / 1000:>10.1f} {site['max_cycles'] * scale / 1000:>9.1f} "
+                  f"{site['max_size']:>10}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Show time spent inside the agent's hooks")
+    parser.add_argument('--agent', choices=SEGMENTS, default='advanced')
+    parser.add_argument('--alloc', action='store_true', help='also show the allocator latency profile')
+    parser.add_argument('--sizes', action='store_true', help='also show the allocation size histograms')
+    parser.add_argument('--sites', action='store_true', help='also show per-site size/lifetime quantiles')
+    parser.add_argument('--ages', action='store_true', help='also show live bytes by age per site')
+    parser.add_argument('--top', action='store_true', help='also show the top-K growing sites')
+    parser.add_argument('--rates', action='store_true', help='also show per-site rates from the count-min sketch')
+    parser.add_argument('--trend', action='store_true', help='also show per-site live-byte growth trends')
+    parser.add_argument('--changes', action='store_true', help='also show detected change points with onset times')
+    parser.add_argument('--interval', type=float, default=0, help='repeat every N seconds')
+    parser.add_argument('--json', action='store_true', help='print JSON instead of a table')
+    args = parser.parse_args()
+
+    path, offset = SEGMENTS[args.agent]
+    try:
+        fd = os.open(path, os.O_RDONLY)
+    except FileNotFoundError:
+        print(f"❌ {path} not found: is a process running with the {args.agent} agent?")
+        return 1
+    error = check_segment(fd, args.agent)
+    if error:
+        print(f"❌ {error}")
+        return 1
+    shm = mmap.mmap(fd, 0, access=mmap.ACCESS_READ)
+
+    try:
+        while True:
+            stats = read_agent_stats(shm, offset)
+            if not stats:
+                print("❌ Agent stats area missing or not initialized (older agent build?)")
+                return 1
+            cycles_per_sec, sample_shift, probes = stats
+            summary = summarize(cycles_per_sec, probes)
+            profile = read_alloc_profile(shm) if args.alloc and args.agent == 'advanced' else None
+            counters = read_cpu_counters(shm, args.agent)
+            sizes = None
+            if args.sizes and args.agent == 'advanced':
+                hist = read_size_histograms(shm)
+                sizes = summarize_sizes(*hist) if hist else None
+            top = read_top_sites(shm) if args.top and args.agent == 'advanced' else None
+            changes = read_change_points(shm) if args.changes and args.agent == 'advanced' else None
+            rates = read_site_rates(shm) if args.rates and args.agent == 'advanced' else None
+            want_sites = (args.sites or args.ages or args.trend) and args.agent == 'advanced'
+            site_sketches = read_site_sketches(shm) if want_sites else None
+            epoch_sec = read_site_ages(shm, site_sketches[2]) if site_sketches and args.ages else None
+            trends = read_site_trends(shm, site_sketches[2]) if site_sketches and args.trend else None
+            scale = 1e9 / cycles_per_sec if cycles_per_sec else 1.0
+            if args.json:
+                report = {'agent': args.agent, 'cycles_per_sec': cycles_per_sec,
+                          'sample_shift': sample_shift, 'probes': summary}
+                if counters:
+                    report['counters'] = dict(counters[1], mode=counters[0])
+                if sizes:
+                    report['sizes'] = sizes
+                if rates:
+                    report['site_rates'] = dict(rates[0], sites=rates[1])
+                if changes:
+                    report['change_points'] = dict(changes[0], alerts=changes[1])
+                if trends:
+                    report['site_trends'] = dict(trends[0], sites=trends[1])
+                if top:
+                    window_ns, evictions, dropped, entries = top
+                    report['top_sites'] = {'window_ns': window_ns, 'evictions': evictions,
+                                           'dropped_bytes': dropped, 'sites': entries}
+                if site_sketches:
+                    sub_bits, overflow, sites = site_sketches
+                    report['site_sketches'] = {'sub_bucket_bits': sub_bits, 'overflow': overflow, 'sites': sites}
+                    if epoch_sec is not None:
+                        report['site_sketches']['epoch_sec'] = epoch_sec
+                if profile:
+                    enabled, outlier_cycles, overflow, classes, sites = profile
+                    report['alloc_profile'] = {
+                        'enabled': bool(enabled),
+                        'outlier_ns': round(outlier_cycles * scale),
+                        'outlier_overflow': overflow,
+                        'size_classes': [dict(op=op, size=size, **s) for (op, size), s in
+                                         summarize(cycles_per_sec, classes).items()],
+                        'outlier_sites': [dict(site, total_ns=round(site['total_cycles'] * scale),
+                                               max_ns=round(site['max_cycles'] * scale)) for site in sites],
+                    }
+                print(json.dumps(report))
+            else:
+                clock = (f"{cycles_per_sec / 1e9:.2f} GHz cycle clock" if cycles_per_sec
+                         else "cycle clock not calibrated yet")
+                print(f"📊 {args.agent} agent self-cost ({clock}, "
+                      f"1 in {1 << sample_shift} calls timed)")
+                print(f"{'probe':<12} {'count':>12} {'mean_ns':>9} {'p50_ns':>9} {'p99_ns':>9} "
+                      f"{'max_ns':>11} {'total_ms':>10}")
+                for name, s in summary.items():
+                    print(f"{name:<12} {s['count']:>12} {s['mean_ns']:>9} {s['p50_ns']:>9} "
+                          f"{s['p99_ns']:>9} {s['max_ns']:>11} {s['total_ms']:>10}")
+                if counters:
+                    mode, totals = counters
+                    print(f"\n🔢 Totals ({mode} counters): " +
+                          ", ".join(f"{name}={value}" for name, value in totals.items()))
+                if args.alloc:
+                    print_alloc_profile(profile, cycles_per_sec, scale)
+                if args.sizes:
+                    print_sizes(sizes)
+                if args.sites:
+                    print_sites(site_sketches)
+                if args.ages:
+                    print_ages(site_sketches, epoch_sec)
+                if args.top:
+                    print_top_sites(top)
+                if args.rates:
+                    print_site_rates(rates)
+                if args.trend:
+                    print_site_trends(trends)
+                if args.changes:
+                    print_change_points(changes)
+            if not args.interval:
+                break
+            time.sleep(args.interval)
+            print()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        shm.close()
+        os.close(fd)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
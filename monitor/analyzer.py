@@ -1,6 +1,7 @@
 #!/usr/bin/env python3
 # simple_ml.py - Ultra simple ML per proof-of-concept
 
+import ctypes
 import json
 import mmap
 import struct
@@ -8,16 +9,56 @@ import time
 import os
 import sys
 
+from agent_stats import read_cpu_counters
+
+# (size >, total >, confidenza): la prima regola che scatta decide. total è
+# il totale di byte allocati dal processo, letto una volta per poll dalle
+# somme per-CPU (agent_stats.read_cpu_counters); total e malloc_count dei
+# record sono invece i totali del thread che ha allocato, e servono solo se
+# le somme non sono leggibili
+RULES = [(30000, 500000, 0.9), (20000, 200000, 0.7), (15000, 100000, 0.5)]
+
+
+class BatchRule(ctypes.Structure):
+    _pack_ = 1
+    _fields_ = [('min_size', ctypes.c_uint64), ('min_total', ctypes.c_uint64)]
+
+
+BATCH_CAPACITY = 1024
+
+
+def load_batch_scorer():
+    """batch_score.so (make) se presente, altrimenti None e si resta in Python; ANALYZER_NATIVE=0 lo esclude"""
+    if os.environ.get('ANALYZER_NATIVE') == '0':
+        return None
+    try:
+        lib = ctypes.CDLL(os.path.join(os.path.dirname(os.path.abspath(__file__)), 'batch_score.so'))
+    except OSError:
+        return None
+    lib.batch_score_isa.restype = ctypes.c_char_p
+    lib.batch_score_basic.restype = ctypes.c_uint32
+    lib.batch_score_basic.argtypes = [ctypes.c_char_p, ctypes.c_uint32, ctypes.c_uint64, ctypes.c_uint64,
+                                      ctypes.POINTER(BatchRule), ctypes.c_uint32,
+                                      ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_uint8)]
+    return lib
+
+
 class SharedMemoryAnalyzer:
     def __init__(self):
         self.buffer_size = 1000
-        # C++ struct: int32_t, uint64_t, uint64_t, int64_t, int32_t
+        # C++ struct: int32_t, uint64_t, uint64_t, int64_t, int32_t, uint64_t
         # Python format: < = little endian, no alignment (packed)
-        # i (4), Q (8), Q (8), q (8), i (4) = 32 bytes total
-        self.allocation_struct = struct.Struct('<iQQqi')
+        # i (4), Q (8), Q (8), q (8), i (4), Q (8) = 40 bytes total
+        self.allocation_struct = struct.Struct('<iQQqiQ')
         self.header_struct = struct.Struct('<ii')         # write_index, read_index
         self.last_read_index = 0
         self.shm = None
+        self.batch = load_batch_scorer()
+        if self.batch:
+            self.rules = (BatchRule * len(RULES))(*[BatchRule(size, total) for size, total, _ in RULES])
+            self.poll_rules = (BatchRule * len(RULES))(*[BatchRule(size, total) for size, total, _ in RULES])
+            self.bitmap = (ctypes.c_uint64 * (BATCH_CAPACITY // 64))()
+            self.tiers = (ctypes.c_uint8 * BATCH_CAPACITY)()
 
     def connect_shared_memory(self, retries=10, delay=0.5):
         # Apre la shared memory creata dall'agent
@@ -61,50 +102,100 @@ class SharedMemoryAnalyzer:
             if len(data) < self.allocation_struct.size:
                 break # Avoid reading partial data
 
-            malloc_count, size, total_bytes, timestamp, is_valid = self.allocation_struct.unpack(data)
+            malloc_count, size, total_bytes, timestamp, is_valid, publish_ns = \
+                self.allocation_struct.unpack(data)
 
             if is_valid:
                 new_allocations.append({
                     'malloc_count': malloc_count,
                     'size': size,
                     'total': total_bytes,
-                    'timestamp': timestamp
+                    'timestamp': timestamp,
+                    'publish_ns': publish_ns
                 })
 
             self.last_read_index += 1
 
         return new_allocations
 
+    def process_total(self):
+        """Byte allocati dal processo (somme per-CPU), o None"""
+        counters = read_cpu_counters(self.shm, 'basic')
+        return counters[1]['bytes_allocated'] if counters else None
+
+    def batch_rules(self, total):
+        """Regole native per questo poll: il termine total è uguale per tutti i
+        record, quindi si valuta qui e una regola che non lo soddisfa non scatta"""
+        if total is None:
+            return self.rules
+        for rule, (min_size, min_total, _) in zip(self.poll_rules, RULES):
+            rule.min_size = min_size if total > min_total else 2**64 - 1
+            rule.min_total = 0
+        return self.poll_rules
+
     def predict_anomaly(self, size, total, malloc_count):
         # Stessa logica di prima
-        if size > 30000 and total > 500000:
-            return True, 0.9
-        elif size > 20000 and total > 200000:
-            return True, 0.7
-        elif size > 15000 and total > 100000:
-            return True, 0.5
-        else:
-            return False, 0.2
+        for min_size, min_total, confidence in RULES:
+            if size > min_size and total > min_total:
+                return True, confidence
+        return False, 0.2
+
+    def score_new_allocations(self):
+        """(allocazione, confidenza) dei record anomali arrivati dall'ultima lettura"""
+        process_total = self.process_total()
+        if not self.batch:
+            anomalies = []
+            for data in self.read_new_allocations():
+                data['process_total'] = process_total
+                total = data['total'] if process_total is None else process_total
+                is_anomaly, confidence = self.predict_anomaly(data['size'], total, data['malloc_count'])
+                if is_anomaly:
+                    anomalies.append((data, confidence))
+            return anomalies
+
+        # Un batch nativo decodifica e valuta fino a BATCH_CAPACITY record;
+        # Python spacchetta solo quelli segnati nella bitmap
+        self.shm.seek(0)
+        write_index, _ = self.header_struct.unpack(self.shm.read(self.header_struct.size))
+        ring_start = self.header_struct.size
+        ring = self.shm[ring_start:ring_start + self.buffer_size * self.allocation_struct.size]
+        rules = self.batch_rules(process_total)
+        anomalies = []
+        while self.last_read_index < write_index:
+            n = self.batch.batch_score_basic(ring, self.buffer_size, self.last_read_index, write_index,
+                                             rules, len(RULES), self.bitmap, self.tiers)
+            for word_index in range((n + 63) // 64):
+                word = self.bitmap[word_index]
+                while word:
+                    bit = (word & -word).bit_length() - 1
+                    word &= word - 1
+                    i = word_index * 64 + bit
+                    slot = (self.last_read_index + i) % self.buffer_size
+                    malloc_count, size, total_bytes, timestamp, _, publish_ns = \
+                        self.allocation_struct.unpack_from(ring, slot * self.allocation_struct.size)
+                    anomalies.append(({'malloc_count': malloc_count, 'size': size, 'total': total_bytes,
+                                       'process_total': process_total, 'timestamp': timestamp,
+                                       'publish_ns': publish_ns},
+                                      RULES[self.tiers[i]][2]))
+            self.last_read_index += n
+        return anomalies
 
     def monitor_real_time(self):
         print(" Starting real-time monitoring...")
+        if self.batch:
+            print(f" Batch scoring: batch_score.so ({self.batch.batch_score_isa().decode()})")
         sys.stdout.flush()
 
         while True:
             try:
-                allocations = self.read_new_allocations()
-
-                for data in allocations:
-                    is_anomaly, confidence = self.predict_anomaly(
-                        data['size'], data['total'], data['malloc_count']
-                    )
-
-                    if is_anomaly:
-                        status = "🚨" if confidence > 0.7 else "⚠️"
-                        print(f"{status} REAL-TIME ALERT #{data['malloc_count']}: "
-                              f"{data['size']}B (total: {data['total']}B) "
-                              f"-> ANOMALY (conf: {confidence:.1f})")
-                        sys.stdout.flush()
+                for data, confidence in self.score_new_allocations():
+                    status = "🚨" if confidence > 0.7 else "⚠️"
+                    total = (f"process total: {data['process_total']}B" if data['process_total'] is not None
+                             else f"thread total: {data['total']}B")
+                    print(f"{status} REAL-TIME ALERT #{data['malloc_count']}: "
+                          f"{data['size']}B ({total}) "
+                          f"-> ANOMALY (conf: {confidence:.1f})")
+                    sys.stdout.flush()
 
                 time.sleep(0.1)  # Check ogni 100ms
             except KeyboardInterrupt:
@@ -0,0 +1,171 @@
+#pragma once
+
+// Native inference for the anomaly model (format in model_format.h).
+//
+// The file is mapped read-only and validated once at load: magic,
+// version, section bounds, hash, and that every node index points
+// forward and every feature is in range. Scoring can then walk the trees
+// without any checks. Nothing here allocates, throws or takes locks, so
+// the engine can run in a collector as well as in the agent's scanner
+// thread (where malloc would re-enter the hooks).
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdint>
+#include "model_format.h"
+
+struct AnomalyModel {
+    const ModelHeader* header;
+    const uint32_t* roots;
+    const ModelNode* nodes;
+    const float* values;
+    uint32_t n_features;
+    uint32_t n_classes;
+    uint32_t positive_class;
+    uint32_t n_trees;
+    void* mapping;
+    size_t mapping_size;
+};
+
+static inline uint64_t model_align8(uint64_t n) {
+    return (n + 7) & ~7ULL;
+}
+
+// Checks the mapped file and fills model; on failure writes why to err
+static bool anomaly_model_validate(AnomalyModel* model, const uint8_t* data, size_t size, char* err,
+                                   size_t err_len) {
+    if (size < sizeof(ModelHeader)) {
+        snprintf(err, err_len, "file too small (%zu bytes)", size);
+        return false;
+    }
+    const ModelHeader* h = (const ModelHeader*)data;
+    if (h->magic != MODEL_MAGIC) {
+        snprintf(err, err_len, "not a model file (magic %#x)", h->magic);
+        return false;
+    }
+    if (h->version_major != MODEL_VERSION_MAJOR) {
+        snprintf(err, err_len, "unsupported format version %u.%u (reader is %u.%u)", h->version_major,
+                 h->version_minor, MODEL_VERSION_MAJOR, MODEL_VERSION_MINOR);
+        return false;
+    }
+    if (h->header_size < sizeof(ModelHeader) || h->header_size % 8 || h->header_size > size ||
+        h->payload_bytes != size - h->header_size) {
+        snprintf(err, err_len, "truncated or oversized file");
+        return false;
+    }
+    if (!h->n_features || !h->n_classes || h->positive_class >= h->n_classes || !h->n_trees || !h->n_nodes ||
+        !h->n_leaves) {
+        snprintf(err, err_len, "empty model");
+        return false;
+    }
+    uint64_t roots_bytes = model_align8((uint64_t)h->n_trees * sizeof(uint32_t));
+    uint64_t nodes_bytes = (uint64_t)h->n_nodes * sizeof(ModelNode);
+    uint64_t values_bytes = model_align8((uint64_t)h->n_leaves * h->n_classes * sizeof(float));
+    if (roots_bytes + nodes_bytes + values_bytes != h->payload_bytes) {
+        snprintf(err, err_len, "section sizes don't add up to the payload");
+        return false;
+    }
+    const uint8_t* payload = data + h->header_size;
+    if (model_fnv1a(payload, h->payload_bytes) != h->payload_hash) {
+        snprintf(err, err_len, "payload hash mismatch (corrupt file)");
+        return false;
+    }
+
+    const uint32_t* roots = (const uint32_t*)payload;
+    const ModelNode* nodes = (const ModelNode*)(payload + roots_bytes);
+    for (uint32_t t = 0; t < h->n_trees; t++) {
+        if (roots[t] >= h->n_nodes) {
+            snprintf(err, err_len, "tree %u: root out of range", t);
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < h->n_nodes; i++) {
+        const ModelNode& node = nodes[i];
+        bool ok = node.feature == MODEL_LEAF
+                      ? node.next < h->n_leaves
+                      : node.feature >= 0 && (uint32_t)node.feature < h->n_features && i + 1 < h->n_nodes &&
+                            node.next > i && node.next < h->n_nodes;
+        if (!ok) {
+            snprintf(err, err_len, "node %u: bad feature or child", i);
+            return false;
+        }
+    }
+
+    model->header = h;
+    model->roots = roots;
+    model->nodes = nodes;
+    model->values = (const float*)(payload + roots_bytes + nodes_bytes);
+    model->n_features = h->n_features;
+    model->n_classes = h->n_classes;
+    model->positive_class = h->positive_class;
+    model->n_trees = h->n_trees;
+    return true;
+}
+
+static bool anomaly_model_load(AnomalyModel* model, const char* path, char* err, size_t err_len) {
+    memset(model, 0, sizeof(*model));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        snprintf(err, err_len, "cannot open %s", path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        snprintf(err, err_len, "cannot stat %s", path);
+        return false;
+    }
+    void* mapping = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        snprintf(err, err_len, "cannot map %s", path);
+        return false;
+    }
+    if (!anomaly_model_validate(model, (const uint8_t*)mapping, (size_t)st.st_size, err, err_len)) {
+        munmap(mapping, (size_t)st.st_size);
+        memset(model, 0, sizeof(*model));
+        return false;
+    }
+    model->mapping = mapping;
+    model->mapping_size = (size_t)st.st_size;
+    return true;
+}
+
+static void anomaly_model_unload(AnomalyModel* model) {
+    if (model->mapping) munmap(model->mapping, model->mapping_size);
+    memset(model, 0, sizeof(*model));
+}
+
+// Leaf row of one tree for feature vector x
+static inline uint32_t anomaly_model_leaf(const AnomalyModel* model, uint32_t tree, const double* x) {
+    const ModelNode* nodes = model->nodes;
+    uint32_t i = model->roots[tree];
+    while (nodes[i].feature != MODEL_LEAF) {
+        i = x[nodes[i].feature] <= nodes[i].threshold ? i + 1 : nodes[i].next;
+    }
+    return nodes[i].next;
+}
+
+// Probability of the positive class: the mean over trees of the leaf's
+// class probability, as a random forest's predict_proba
+static inline double anomaly_model_score(const AnomalyModel* model, const double* x) {
+    double sum = 0;
+    for (uint32_t t = 0; t < model->n_trees; t++) {
+        sum += model->values[anomaly_model_leaf(model, t, x) * model->n_classes + model->positive_class];
+    }
+    return sum / model->n_trees;
+}
+
+// All class probabilities into proba[n_classes]
+static inline void anomaly_model_predict_proba(const AnomalyModel* model, const double* x, double* proba) {
+    for (uint32_t c = 0; c < model->n_classes; c++) proba[c] = 0;
+    for (uint32_t t = 0; t < model->n_trees; t++) {
+        const float* row = model->values + (size_t)anomaly_model_leaf(model, t, x) * model->n_classes;
+        for (uint32_t c = 0; c < model->n_classes; c++) proba[c] += row[c];
+    }
+    for (uint32_t c = 0; c < model->n_classes; c++) proba[c] /= model->n_trees;
+}
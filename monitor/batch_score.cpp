@@ -0,0 +1,28 @@
+// Batch scorer for the Python analyzers
+// =====================================
+//
+// C entry points over batch_score.h, built as batch_score.so and loaded
+// with ctypes by analyzer.py: one call decodes and scores up to
+// BATCH_CAPACITY ring records instead of a struct.unpack and a chain of
+// if/elif per record. The ring is passed as a copy of the slot array
+// (bytes), so the analyzer's mmap stays closable.
+
+#include "batch_score.h"
+
+extern "C" {
+
+const char* batch_score_isa() {
+    return batch_isa();
+}
+
+// Scores basic ring positions [from, to) (at most BATCH_CAPACITY, the
+// return value); bit i of bitmap / tiers[i] describe position from + i
+uint32_t batch_score_basic(const void* ring, uint32_t capacity, uint64_t from, uint64_t to, const BatchRule* rules,
+                           uint32_t n_rules, uint64_t* bitmap, uint8_t* tiers) {
+    static thread_local RecordBatch batch;
+    uint32_t n = batch_decode_basic((const AllocationData*)ring, capacity, from, to, &batch);
+    batch_score(&batch, rules, n_rules, bitmap, tiers);
+    return n;
+}
+
+}
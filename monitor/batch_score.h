@@ -0,0 +1,145 @@
+#pragma once
+
+// Batch scoring of ring records.
+//
+// A consumer that scores records one at a time pays the decode and the
+// rule branches per record. Here a batch of ring positions is decoded
+// once into struct-of-arrays columns (size, total) and the
+// rules are evaluated over the columns, four records per AVX2 step, with
+// a scalar loop for CPUs without AVX2 (or BATCH_SCORE_ISA=scalar). The
+// result is a bitmap of anomalous records plus, optionally, the index of
+// the first rule each record matched.
+//
+// A rule matches when size > min_size and total > min_total, so an empty
+// slot (decoded as all zeros) never matches. The basic ring has no call
+// site field, so there is no site column. Records are copied out of the ring with memcpy like every
+// other reader; a slot the agent overwrites meanwhile can be torn, as it
+// can for the Python reader.
+
+#include <stdlib.h>
+#include <string.h>
+#include <cstdint>
+#include <immintrin.h>
+#include "shm_layout.h"
+
+#define BATCH_CAPACITY 1024  // >= BUFFER_SIZE: one pass drains a full ring
+#define BATCH_NO_RULE 0xff
+
+struct BatchRule {
+    uint64_t min_size;
+    uint64_t min_total;
+} __attribute__((packed));
+
+struct RecordBatch {
+    uint32_t count;
+    alignas(32) uint64_t size[BATCH_CAPACITY];
+    alignas(32) uint64_t total[BATCH_CAPACITY];
+};
+
+// Basic ring positions [from, to), at most BATCH_CAPACITY; returns the count
+static inline uint32_t batch_decode_basic(const AllocationData* ring, uint32_t capacity, uint64_t from, uint64_t to,
+                                          RecordBatch* batch) {
+    uint32_t n = to - from < BATCH_CAPACITY ? (uint32_t)(to - from) : BATCH_CAPACITY;
+    uint32_t slot = (uint32_t)(from % capacity);
+    for (uint32_t i = 0; i < n; i++, slot = slot + 1 == capacity ? 0 : slot + 1) {
+        AllocationData rec;
+        memcpy(&rec, (const void*)&ring[slot], sizeof(rec));
+        bool valid = rec.is_valid == 1;
+        batch->size[i] = valid ? rec.size : 0;
+        batch->total[i] = valid ? rec.total_bytes : 0;
+    }
+    batch->count = n;
+    return n;
+}
+
+// First rule record i matches, or BATCH_NO_RULE
+static inline uint8_t batch_rule_tier(const RecordBatch* batch, uint32_t i, const BatchRule* rules,
+                                      uint32_t n_rules) {
+    uint8_t tier = BATCH_NO_RULE;
+    for (uint32_t r = n_rules; r-- > 0;) {
+        bool match = (batch->size[i] > rules[r].min_size) & (batch->total[i] > rules[r].min_total);
+        tier = match ? (uint8_t)r : tier;
+    }
+    return tier;
+}
+
+// Records from start on; ORs into bitmap, which batch_score() zeroes
+static inline void batch_score_scalar(const RecordBatch* batch, const BatchRule* rules, uint32_t n_rules,
+                                      uint64_t* bitmap, uint8_t* tiers, uint32_t start = 0) {
+    uint64_t word = 0;
+    for (uint32_t i = start; i < batch->count; i++) {
+        uint8_t tier = batch_rule_tier(batch, i, rules, n_rules);
+        word |= (uint64_t)(tier != BATCH_NO_RULE) << (i % 64);
+        if (tiers) tiers[i] = tier;
+        if (i % 64 == 63 || i + 1 == batch->count) {
+            bitmap[i / 64] |= word;
+            word = 0;
+        }
+    }
+}
+
+#define BATCH_MAX_RULES 16   // AVX2 path's constant table; longer rule lists are scored scalar
+
+// AVX2 has only a signed 64-bit compare: with the sign bit flipped on both
+// sides it orders unsigned values
+__attribute__((target("avx2"))) static void batch_score_avx2(const RecordBatch* batch, const BatchRule* rules,
+                                                             uint32_t n_rules, uint64_t* bitmap, uint8_t* tiers) {
+    const __m256i sign = _mm256_set1_epi64x((long long)0x8000000000000000ULL);
+    __m256i min_size[BATCH_MAX_RULES], min_total[BATCH_MAX_RULES];
+    for (uint32_t r = 0; r < n_rules; r++) {
+        min_size[r] = _mm256_set1_epi64x((long long)(rules[r].min_size ^ 0x8000000000000000ULL));
+        min_total[r] = _mm256_set1_epi64x((long long)(rules[r].min_total ^ 0x8000000000000000ULL));
+    }
+
+    uint32_t vector_end = batch->count & ~3u;
+    uint64_t word = 0;
+    for (uint32_t i = 0; i < vector_end; i += 4) {
+        __m256i size = _mm256_xor_si256(_mm256_load_si256((const __m256i*)&batch->size[i]), sign);
+        __m256i total = _mm256_xor_si256(_mm256_load_si256((const __m256i*)&batch->total[i]), sign);
+        __m256i tier = _mm256_set1_epi64x(BATCH_NO_RULE);
+        __m256i any = _mm256_setzero_si256();
+        // Last rule first, so the first matching rule wins the blend
+        for (uint32_t r = n_rules; r-- > 0;) {
+            __m256i match = _mm256_and_si256(_mm256_cmpgt_epi64(size, min_size[r]),
+                                             _mm256_cmpgt_epi64(total, min_total[r]));
+            if (tiers) tier = _mm256_blendv_epi8(tier, _mm256_set1_epi64x(r), match);
+            any = _mm256_or_si256(any, match);
+        }
+        word |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(any)) << (i % 64);
+        if (i % 64 == 60) {
+            bitmap[i / 64] = word;
+            word = 0;
+        }
+        if (tiers) {
+            alignas(32) uint64_t lanes[4];
+            _mm256_store_si256((__m256i*)lanes, tier);
+            for (int lane = 0; lane < 4; lane++) tiers[i + lane] = (uint8_t)lanes[lane];
+        }
+    }
+    if (vector_end % 64) bitmap[vector_end / 64] = word;
+    batch_score_scalar(batch, rules, n_rules, bitmap, tiers, vector_end);
+}
+
+// Checked once: AVX2 unless the CPU lacks it or BATCH_SCORE_ISA=scalar
+static inline bool batch_use_avx2() {
+    static const bool use = [] {
+        const char* isa = getenv("BATCH_SCORE_ISA");
+        return __builtin_cpu_supports("avx2") && !(isa && strcmp(isa, "scalar") == 0);
+    }();
+    return use;
+}
+
+static inline const char* batch_isa() {
+    return batch_use_avx2() ? "avx2" : "scalar";
+}
+
+// bitmap needs (count + 63) / 64 words; tiers (optional) count bytes
+static inline void batch_score(const RecordBatch* batch, const BatchRule* rules, uint32_t n_rules, uint64_t* bitmap,
+                               uint8_t* tiers) {
+    memset(bitmap, 0, ((batch->count + 63) / 64) * sizeof(uint64_t));
+    if (batch_use_avx2() && n_rules <= BATCH_MAX_RULES) {
+        batch_score_avx2(batch, rules, n_rules, bitmap, tiers);
+    } else {
+        batch_score_scalar(batch, rules, n_rules, bitmap, tiers);
+    }
+}
@@ -0,0 +1,429 @@
+// Offline allocator what-if simulator
+// ===================================
+//
+// Replays a recorded trace (trace_format.h) against simulated allocator
+// policies without allocating anything, and reports per policy:
+//   - peak and final RSS (resident pages of slabs and large mappings)
+//   - internal fragmentation (size-class rounding) and external
+//     fragmentation (resident bytes not holding live objects) at peak
+//   - cache friendliness: how often consecutive allocations of a thread
+//     land on the same page, and how many small objects share a cache
+//     line with a live object of another thread (false-sharing risk)
+//   - map/unmap calls, a proxy for syscall and page-fault churn
+//
+// Model: small requests are rounded to a size class and carved from
+// fixed-size slabs owned by an arena (shared, or one per thread); large
+// requests get their own page-rounded mapping. Empty slabs are either
+// returned to the OS or kept in a per-arena cache for reuse. Huge-page
+// backing makes slabs and large mappings resident in 2 MB units.
+//
+// Policies are given as name:key=value,... with keys
+//   classes=fine|pow2   arenas=shared|thread   cache=N (slabs)   huge=0|1
+// e.g. --policy "mine:classes=pow2,arenas=thread,cache=8,huge=0".
+// Without --policy a built-in set is compared.
+//
+// Usage: alloc_sim --trace FILE [--policy SPEC]... [--json FILE]
+
+#include <algorithm>
+#include <memory>
+#include "bench_util.h"
+#include "trace_format.h"
+
+#define SMALL_PAGE 4096ULL
+#define HUGE_PAGE (2ULL << 20)
+#define SLAB_SIZE (64ULL << 10)
+#define CACHE_LINE 64ULL
+#define MAX_SMALL_SIZE (32ULL << 10)
+
+struct Policy {
+    std::string name;
+    bool pow2_classes = false;
+    bool per_thread_arenas = false;
+    size_t slab_cache = 0;  // empty slabs kept per arena
+    bool huge_pages = false;
+};
+
+// "fine": 16 B steps to 256, then 4 classes per doubling (jemalloc-like)
+static std::vector<size_t> build_size_classes(bool pow2) {
+    std::vector<size_t> classes;
+    if (pow2) {
+        for (size_t c = 16; c <= MAX_SMALL_SIZE; c *= 2) classes.push_back(c);
+        return classes;
+    }
+    for (size_t c = 16; c <= 256; c += 16) classes.push_back(c);
+    for (size_t base = 256; base < MAX_SMALL_SIZE; base *= 2) {
+        for (int i = 1; i <= 4; i++) classes.push_back(base + base / 4 * i);
+    }
+    return classes;
+}
+
+struct Slab {
+    uint64_t base;           // simulated virtual address
+    size_t class_idx;
+    size_t object_size;
+    uint32_t capacity;
+    uint32_t used = 0;
+    uint32_t fresh = 0;      // slots never handed out yet (bump pointer)
+    uint64_t resident = 0;   // bytes counted in RSS
+    int list_pos = -1;       // position in the arena's partial list
+    std::vector<uint32_t> free_slots;
+    std::vector<int32_t> owner;  // thread holding each slot, -1 = free
+};
+
+struct Arena {
+    std::vector<std::vector<Slab*>> partial;  // per class: slabs with free slots
+    std::vector<Slab*> empty_cache;
+};
+
+struct ObjectState {
+    bool live = false;
+    bool large = false;
+    Slab* slab = nullptr;
+    uint32_t index = 0;
+    uint64_t addr = 0;
+    uint64_t requested = 0;
+    uint64_t footprint = 0;  // rounded size (class or mapping)
+};
+
+struct SimResult {
+    uint64_t peak_rss = 0, final_rss = 0;
+    uint64_t live_requested_at_peak = 0, live_rounded_at_peak = 0;
+    uint64_t maps = 0, unmaps = 0;
+    uint64_t same_page_pairs = 0, alloc_pairs = 0;
+    uint64_t small_allocs = 0, shared_line_allocs = 0;
+};
+
+class AllocatorSim {
+public:
+    AllocatorSim(const Policy& p, size_t threads, size_t objects)
+        : policy(p), classes(build_size_classes(p.pow2_classes)),
+          page(p.huge_pages ? HUGE_PAGE : SMALL_PAGE),
+          slab_size(p.huge_pages ? HUGE_PAGE : SLAB_SIZE),
+          arenas(p.per_thread_arenas ? std::max<size_t>(threads, 1) : 1),
+          objects(objects), last_addr(threads, 0) {
+        for (Arena& a : arenas) a.partial.resize(classes.size());
+    }
+
+    void apply(const TraceRecord& r) {
+        ObjectState& obj = objects[r.slot];
+        switch (r.op) {
+        case TOP_MALLOC:
+        case TOP_CALLOC:
+            if (obj.live) release(obj);  // id reused without a free
+            allocate(obj, r.size, r.thread);
+            break;
+        case TOP_REALLOC:
+            if (obj.live && !obj.large && r.size <= obj.footprint && r.size > obj.footprint / 2) {
+                live_requested += r.size - obj.requested;  // fits in place
+                obj.requested = r.size;
+            } else {
+                if (obj.live) release(obj);
+                allocate(obj, r.size, r.thread);
+            }
+            break;
+        case TOP_FREE:
+            if (obj.live) release(obj);
+            break;
+        default:
+            break;
+        }
+
+        if (rss > result.peak_rss) {
+            result.peak_rss = rss;
+            result.live_requested_at_peak = live_requested;
+            result.live_rounded_at_peak = live_rounded;
+        }
+    }
+
+    ~AllocatorSim() {
+        for (auto& entry : slab_arena) delete entry.first;
+    }
+
+    SimResult finish() {
+        result.final_rss = rss;
+        return result;
+    }
+
+private:
+    size_t class_for(size_t size) const {
+        return std::lower_bound(classes.begin(), classes.end(), std::max<size_t>(size, 1)) - classes.begin();
+    }
+
+    static uint64_t round_up(uint64_t v, uint64_t to) { return (v + to - 1) / to * to; }
+
+    void allocate(ObjectState& obj, size_t size, uint32_t thread) {
+        obj.live = true;
+        obj.requested = size;
+
+        if (size > MAX_SMALL_SIZE) {
+            // Huge pages only back mappings big enough to use them
+            uint64_t granule = (policy.huge_pages && size >= HUGE_PAGE / 2) ? HUGE_PAGE : SMALL_PAGE;
+            obj.large = true;
+            obj.footprint = round_up(size, granule);
+            obj.addr = next_addr;
+            next_addr += obj.footprint + SMALL_PAGE;
+            rss += obj.footprint;
+            result.maps++;
+        } else {
+            size_t ci = class_for(size);
+            Arena& arena = arenas[policy.per_thread_arenas ? thread : 0];
+            Slab* slab = arena.partial[ci].empty() ? new_slab(arena, ci) : arena.partial[ci].back();
+
+            uint32_t idx;
+            if (!slab->free_slots.empty()) {
+                idx = slab->free_slots.back();
+                slab->free_slots.pop_back();
+            } else {
+                idx = slab->fresh++;
+                // First touch of a new page makes it resident
+                uint64_t touched = round_up((uint64_t)slab->fresh * slab->object_size, page);
+                if (touched > slab->resident) {
+                    rss += touched - slab->resident;
+                    slab->resident = touched;
+                }
+            }
+            slab->used++;
+            slab->owner[idx] = thread;
+            if (slab->used == slab->capacity) remove_partial(arena, slab);
+
+            obj.large = false;
+            obj.slab = slab;
+            obj.index = idx;
+            obj.footprint = slab->object_size;
+            obj.addr = slab->base + (uint64_t)idx * slab->object_size;
+
+            result.small_allocs++;
+            if (shares_line_with_other_thread(slab, idx, thread)) result.shared_line_allocs++;
+        }
+
+        live_requested += size;
+        live_rounded += obj.footprint;
+
+        uint64_t& prev = last_addr[thread];
+        if (prev) {
+            result.alloc_pairs++;
+            if (prev / SMALL_PAGE == obj.addr / SMALL_PAGE) result.same_page_pairs++;
+        }
+        prev = obj.addr;
+    }
+
+    void release(ObjectState& obj) {
+        live_requested -= obj.requested;
+        live_rounded -= obj.footprint;
+        obj.live = false;
+
+        if (obj.large) {
+            rss -= obj.footprint;
+            result.unmaps++;
+            return;
+        }
+
+        Slab* slab = obj.slab;
+        Arena& arena = arenas[arena_of(slab)];
+        bool was_full = slab->used == slab->capacity;
+        slab->owner[obj.index] = -1;
+        slab->free_slots.push_back(obj.index);
+        slab->used--;
+
+        if (slab->used == 0) {
+            remove_partial(arena, slab);
+            if (arena.empty_cache.size() < policy.slab_cache) {
+                arena.empty_cache.push_back(slab);  // stays resident
+            } else {
+                rss -= slab->resident;
+                result.unmaps++;
+                slab_arena.erase(slab);
+                delete slab;
+            }
+        } else if (was_full) {
+            add_partial(arena, slab);
+        }
+    }
+
+    Slab* new_slab(Arena& arena, size_t ci) {
+        Slab* slab;
+        if (!arena.empty_cache.empty()) {
+            // Reuse a cached slab for whatever class needs it; its pages
+            // are already resident
+            slab = arena.empty_cache.back();
+            arena.empty_cache.pop_back();
+        } else {
+            slab = new Slab();
+            slab->base = next_addr;
+            next_addr += slab_size;
+            slab_arena[slab] = &arena - arenas.data();
+            result.maps++;
+        }
+        slab->class_idx = ci;
+        slab->object_size = classes[ci];
+        slab->capacity = (uint32_t)(slab_size / classes[ci]);
+        slab->used = 0;
+        slab->free_slots.clear();
+        slab->owner.assign(slab->capacity, -1);
+        // A recycled slab's resident pages count as already touched
+        slab->fresh = (uint32_t)std::min<uint64_t>(slab->resident / slab->object_size, slab->capacity);
+        for (uint32_t i = slab->fresh; i-- > 0;) slab->free_slots.push_back(i);
+        add_partial(arena, slab);
+        return slab;
+    }
+
+    void add_partial(Arena& arena, Slab* slab) {
+        auto& list = arena.partial[slab->class_idx];
+        slab->list_pos = (int)list.size();
+        list.push_back(slab);
+    }
+
+    void remove_partial(Arena& arena, Slab* slab) {
+        if (slab->list_pos < 0) return;
+        auto& list = arena.partial[slab->class_idx];
+        list[slab->list_pos] = list.back();
+        list[slab->list_pos]->list_pos = slab->list_pos;
+        list.pop_back();
+        slab->list_pos = -1;
+    }
+
+    size_t arena_of(Slab* slab) const { return slab_arena.at(slab); }
+
+    bool shares_line_with_other_thread(const Slab* slab, uint32_t idx, uint32_t thread) const {
+        if (slab->object_size >= CACHE_LINE) return false;
+        uint64_t start = (uint64_t)idx * slab->object_size;
+        uint32_t first = (uint32_t)(start / CACHE_LINE * CACHE_LINE / slab->object_size);
+        uint32_t last = (uint32_t)std::min<uint64_t>((start / CACHE_LINE + 1) * CACHE_LINE / slab->object_size,
+                                                     slab->capacity - 1);
+        for (uint32_t i = first; i <= last; i++) {
+            if (i != idx && slab->owner[i] >= 0 && (uint32_t)slab->owner[i] != thread) return true;
+        }
+        return false;
+    }
+
+    Policy policy;
+    std::vector<size_t> classes;
+    uint64_t page;
+    uint64_t slab_size;
+    std::vector<Arena> arenas;
+    std::vector<ObjectState> objects;
+    std::unordered_map<Slab*, size_t> slab_arena;
+    std::vector<uint64_t> last_addr;
+    uint64_t next_addr = 1ULL << 32;
+    uint64_t rss = 0;
+    uint64_t live_requested = 0;
+    uint64_t live_rounded = 0;
+    SimResult result;
+};
+
+static bool parse_policy(const char* spec, Policy* p) {
+    std::string s = spec;
+    size_t colon = s.find(':');
+    p->name = s.substr(0, colon);
+    if (colon == std::string::npos) return !p->name.empty();
+
+    std::string rest = s.substr(colon + 1);
+    size_t pos = 0;
+    while (pos < rest.size()) {
+        size_t comma = rest.find(',', pos);
+        std::string kv = rest.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        pos = comma == std::string::npos ? rest.size() : comma + 1;
+
+        size_t eq = kv.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = kv.substr(0, eq), val = kv.substr(eq + 1);
+        if (key == "classes" && (val == "fine" || val == "pow2")) p->pow2_classes = val == "pow2";
+        else if (key == "arenas" && (val == "shared" || val == "thread")) p->per_thread_arenas = val == "thread";
+        else if (key == "cache") p->slab_cache = strtoull(val.c_str(), nullptr, 10);
+        else if (key == "huge" && (val == "0" || val == "1")) p->huge_pages = val == "1";
+        else return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* trace_path = bench_arg(argc, argv, "--trace", nullptr);
+    const char* json_path = bench_arg(argc, argv, "--json", nullptr);
+
+    std::vector<Policy> policies;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--policy") != 0) continue;
+        Policy p;
+        if (!parse_policy(argv[i + 1], &p)) {
+            fprintf(stderr, "Invalid policy '%s' (expected name:classes=fine|pow2,arenas=shared|thread,"
+                            "cache=N,huge=0|1)\n", argv[i + 1]);
+            return 1;
+        }
+        policies.push_back(p);
+    }
+    if (policies.empty()) {
+        const char* defaults[] = {
+            "shared_pow2:classes=pow2,arenas=shared,cache=0,huge=0",
+            "shared_fine:classes=fine,arenas=shared,cache=0,huge=0",
+            "thread_fine:classes=fine,arenas=thread,cache=0,huge=0",
+            "thread_fine_cached:classes=fine,arenas=thread,cache=16,huge=0",
+            "thread_fine_cached_huge:classes=fine,arenas=thread,cache=16,huge=1",
+        };
+        for (const char* d : defaults) {
+            Policy p;
+            parse_policy(d, &p);
+            policies.push_back(p);
+        }
+    }
+
+    if (!trace_path) {
+        fprintf(stderr, "Usage: %s --trace FILE [--policy SPEC]... [--json FILE]\n", argv[0]);
+        return 1;
+    }
+
+    Trace trace;
+    if (!load_trace(trace_path, &trace)) return 1;
+    // Interleave threads in recorded time order
+    std::stable_sort(trace.records.begin(), trace.records.end(),
+                     [](const TraceRecord& a, const TraceRecord& b) { return a.t_ns < b.t_ns; });
+
+    printf("=== ALLOCATOR WHAT-IF SIMULATION ===\n");
+    printf("trace: %zu ops, %zu threads, %zu objects\n\n", trace.records.size(), trace.num_threads,
+           trace.num_objects);
+    printf("%-24s %10s %10s %8s %8s %9s %9s %8s\n", "policy", "peak_rss_kb", "final_kb", "int_frag",
+           "ext_frag", "same_page", "shared_ln", "maps");
+
+    std::string json = "{\n  \"benchmark\": \"alloc_sim\",\n";
+    json += "  \"trace\": \"" + std::string(trace_path) + "\",\n";
+    json += "  \"policies\": [\n";
+
+    for (size_t i = 0; i < policies.size(); i++) {
+        const Policy& p = policies[i];
+        std::unique_ptr<AllocatorSim> sim(new AllocatorSim(p, trace.num_threads, trace.num_objects));
+        for (const TraceRecord& r : trace.records) sim->apply(r);
+        SimResult res = sim->finish();
+
+        double int_frag = res.live_rounded_at_peak
+                              ? 1.0 - (double)res.live_requested_at_peak / res.live_rounded_at_peak : 0;
+        double ext_frag = res.peak_rss ? 1.0 - (double)res.live_rounded_at_peak / res.peak_rss : 0;
+        double same_page = res.alloc_pairs ? (double)res.same_page_pairs / res.alloc_pairs : 0;
+        double shared_line = res.small_allocs ? (double)res.shared_line_allocs / res.small_allocs : 0;
+
+        printf("%-24s %10lu %10lu %7.1f%% %7.1f%% %8.1f%% %8.1f%% %8lu\n", p.name.c_str(),
+               res.peak_rss / 1024, res.final_rss / 1024, int_frag * 100, ext_frag * 100,
+               same_page * 100, shared_line * 100, res.maps);
+
+        char buf[768];
+        snprintf(buf, sizeof(buf),
+                 "    {\"name\": \"%s\", \"classes\": \"%s\", \"arenas\": \"%s\", \"slab_cache\": %zu, "
+                 "\"huge_pages\": %s,\n     \"peak_rss_bytes\": %lu, \"final_rss_bytes\": %lu, "
+                 "\"live_requested_at_peak\": %lu, \"internal_fragmentation\": %.4f, "
+                 "\"external_fragmentation\": %.4f,\n     \"same_page_alloc_ratio\": %.4f, "
+                 "\"shared_cache_line_ratio\": %.4f, \"maps\": %lu, \"unmaps\": %lu}",
+                 p.name.c_str(), p.pow2_classes ? "pow2" : "fine", p.per_thread_arenas ? "thread" : "shared",
+                 p.slab_cache, p.huge_pages ? "true" : "false", res.peak_rss, res.final_rss,
+                 res.live_requested_at_peak, int_frag, ext_frag, same_page, shared_line, res.maps, res.unmaps);
+        if (i) json += ",\n";
+        json += buf;
+    }
+    json += "\n  ]\n}\n";
+
+    printf("\nint_frag = class rounding waste, ext_frag = resident bytes not holding live blocks (at peak)\n");
+    printf("same_page = consecutive allocations of a thread on one page, shared_ln = false-sharing risk\n");
+
+    if (json_path) {
+        if (!write_text_file(json_path, json)) return 1;
+        printf("JSON results written to %s\n", json_path);
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+// Batch scoring benchmark
+// =======================
+//
+// Scores a synthetic basic ring (AllocationData records, same rules as
+// analyzer.py) three ways and reports ns per record:
+//   - record:  copy one record, if/else-if over the rules (the analyzer's
+//              per-record loop, minus the Python)
+//   - scalar:  batch_score.h decode into columns + scalar rule loop
+//   - avx2:    the same columns, four records per step
+// and checks that all three flag the same records with the same rule.
+//
+// Usage: batch_bench [--records N] [--anomalous-pct P] [--json FILE]
+
+#include <random>
+#include "bench_util.h"
+#include "../batch_score.h"
+
+static const BatchRule RULES[] = {
+    {30000, 500000},
+    {20000, 200000},
+    {15000, 100000},
+};
+static const uint32_t N_RULES = sizeof(RULES) / sizeof(RULES[0]);
+
+// Per-record reference: returns the number of anomalous records
+static uint64_t score_per_record(const AllocationData* ring, uint64_t records, uint8_t* tiers) {
+    uint64_t flagged = 0;
+    for (uint64_t pos = 0; pos < records; pos++) {
+        AllocationData rec;
+        memcpy(&rec, &ring[pos % BUFFER_SIZE], sizeof(rec));
+        uint8_t tier = BATCH_NO_RULE;
+        if (rec.is_valid == 1) {
+            for (uint32_t r = 0; r < N_RULES; r++) {
+                if (rec.size > RULES[r].min_size && rec.total_bytes > RULES[r].min_total) {
+                    tier = r;
+                    break;
+                }
+            }
+        }
+        tiers[pos] = tier;
+        flagged += tier != BATCH_NO_RULE;
+    }
+    return flagged;
+}
+
+typedef void (*score_fn)(const RecordBatch*, const BatchRule*, uint32_t, uint64_t*, uint8_t*);
+
+static void score_scalar(const RecordBatch* batch, const BatchRule* rules, uint32_t n_rules, uint64_t* bitmap,
+                         uint8_t* tiers) {
+    memset(bitmap, 0, ((batch->count + 63) / 64) * sizeof(uint64_t));
+    batch_score_scalar(batch, rules, n_rules, bitmap, tiers);
+}
+
+static void score_avx2(const RecordBatch* batch, const BatchRule* rules, uint32_t n_rules, uint64_t* bitmap,
+                       uint8_t* tiers) {
+    memset(bitmap, 0, ((batch->count + 63) / 64) * sizeof(uint64_t));
+    batch_score_avx2(batch, rules, n_rules, bitmap, tiers);
+}
+
+// Returns the number of anomalous records; tiers[pos] per record
+static uint64_t score_batched(const AllocationData* ring, uint64_t records, score_fn score, uint8_t* tiers) {
+    static RecordBatch batch;
+    uint64_t bitmap[BATCH_CAPACITY / 64];
+    uint64_t flagged = 0;
+    for (uint64_t pos = 0; pos < records;) {
+        uint32_t n = batch_decode_basic(ring, BUFFER_SIZE, pos, records, &batch);
+        score(&batch, RULES, N_RULES, bitmap, tiers + pos);
+        for (uint32_t w = 0; w < (n + 63) / 64; w++) flagged += __builtin_popcountll(bitmap[w]);
+        pos += n;
+    }
+    return flagged;
+}
+
+int main(int argc, char** argv) {
+    uint64_t records = strtoull(bench_arg(argc, argv, "--records", "10000000"), nullptr, 10);
+    double anomalous_pct = atof(bench_arg(argc, argv, "--anomalous-pct", "1"));
+    const char* json_path = bench_arg(argc, argv, "--json", nullptr);
+
+    // Mostly small allocations, a few large ones past the rule thresholds
+    static AllocationData ring[BUFFER_SIZE];
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> coin(0, 100);
+    std::uniform_int_distribution<uint64_t> small(16, 4096), large(15000, 60000);
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < BUFFER_SIZE; i++) {
+        uint64_t size = coin(rng) < anomalous_pct ? large(rng) : small(rng);
+        total += size;
+        ring[i] = {(int32_t)i, size, total, 0, coin(rng) < 99 ? 1 : 0, 1000000ULL * (i + 1)};
+    }
+
+    std::vector<uint8_t> expected(records), tiers(records);
+    struct Run {
+        const char* name;
+        double ns_per_record;
+    } runs[3] = {{"record", 0}, {"scalar", 0}, {"avx2", 0}};
+    bool has_avx2 = __builtin_cpu_supports("avx2");
+
+    uint64_t t0 = bench_now_ns();
+    uint64_t flagged = score_per_record(ring, records, expected.data());
+    runs[0].ns_per_record = (double)(bench_now_ns() - t0) / records;
+
+    int rc = 0;
+    for (int k = 1; k < 3; k++) {
+        if (k == 2 && !has_avx2) continue;
+        t0 = bench_now_ns();
+        uint64_t n = score_batched(ring, records, k == 1 ? score_scalar : score_avx2, tiers.data());
+        runs[k].ns_per_record = (double)(bench_now_ns() - t0) / records;
+        if (n != flagged || tiers != expected) {
+            fprintf(stderr, "❌ %s disagrees with the per-record rules\n", runs[k].name);
+            rc = 1;
+        }
+    }
+
+    printf("⏱️  %lu records, %lu anomalous:\n", (unsigned long)records, (unsigned long)flagged);
+    for (const Run& run : runs) {
+        if (run.ns_per_record == 0) {
+            printf("   %-7s (no AVX2 on this CPU)\n", run.name);
+            continue;
+        }
+        printf("   %-7s %.2f ns/record (%.1f M records/s)\n", run.name, run.ns_per_record, 1000 / run.ns_per_record);
+    }
+
+    if (json_path) {
+        std::string out = "{\"records\": " + std::to_string(records) + ", \"anomalous\": " + std::to_string(flagged);
+        for (const Run& run : runs) {
+            char buf[96];
+            snprintf(buf, sizeof(buf), ", \"%s_ns_per_record\": %.3f", run.name, run.ns_per_record);
+            out += buf;
+        }
+        out += "}\n";
+        if (!write_text_file(json_path, out)) rc = 1;
+    }
+    return rc;
+}
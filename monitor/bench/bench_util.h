@@ -0,0 +1,109 @@
+#pragma once
+
+// Shared helpers for the agent benchmarks in this directory.
+// Everything here is header-only so each benchmark stays a single
+// translation unit that can be run with or without LD_PRELOAD.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Same clock the agents use for their own timestamps
+static inline uint64_t bench_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Keep the compiler from eliding malloc/free pairs whose result is unused
+static inline void bench_escape(void* p) {
+    asm volatile("" : : "g"(p) : "memory");
+}
+
+// Latency summary computed from raw per-call samples
+struct LatencySummary {
+    uint64_t count;
+    double mean_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+};
+
+// Sorts the samples in place
+static inline LatencySummary summarize_latency(std::vector<uint64_t>& samples) {
+    LatencySummary s = {};
+    if (samples.empty()) return s;
+
+    std::sort(samples.begin(), samples.end());
+    s.count = samples.size();
+
+    long double sum = 0;
+    for (uint64_t v : samples) sum += v;
+    s.mean_ns = (double)(sum / samples.size());
+
+    auto pct = [&](double q) {
+        size_t idx = (size_t)(q * (samples.size() - 1));
+        return samples[idx];
+    };
+    s.p50_ns = pct(0.50);
+    s.p90_ns = pct(0.90);
+    s.p99_ns = pct(0.99);
+    s.p999_ns = pct(0.999);
+    s.max_ns = samples.back();
+    return s;
+}
+
+// Smallest observable back-to-back clock delta, subtracted from samples
+static inline uint64_t calibrate_timer_overhead_ns() {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 10000; i++) {
+        uint64_t t0 = bench_now_ns();
+        uint64_t t1 = bench_now_ns();
+        if (t1 - t0 < best) best = t1 - t0;
+    }
+    return best;
+}
+
+static inline void append_latency_json(std::string& out, const LatencySummary& s) {
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "\"count\": %lu, \"mean_ns\": %.1f, \"p50_ns\": %lu, \"p90_ns\": %lu, "
+             "\"p99_ns\": %lu, \"p999_ns\": %lu, \"max_ns\": %lu",
+             s.count, s.mean_ns, s.p50_ns, s.p90_ns, s.p99_ns, s.p999_ns, s.max_ns);
+    out += buf;
+}
+
+// Which agent (if any) is preloaded, so results are self-describing
+static inline const char* detect_agent_name() {
+    const char* preload = getenv("LD_PRELOAD");
+    if (!preload || !*preload) return "baseline";
+    if (strstr(preload, "advanced_agent")) return "advanced_agent";
+    if (strstr(preload, "agent")) return "agent";
+    return preload;
+}
+
+static inline bool write_text_file(const char* path, const std::string& text) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    fwrite(text.data(), 1, text.size(), f);
+    fclose(f);
+    return true;
+}
+
+// Minimal "--key value" argument lookup
+static inline const char* bench_arg(int argc, char** argv, const char* key, const char* def) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], key) == 0) return argv[i + 1];
+    }
+    return def;
+}
@@ -0,0 +1,202 @@
+// Hook overhead microbenchmark
+// ============================
+//
+// Measures ns/op of malloc/free/realloc/calloc across size classes and
+// the multithreaded malloc+free throughput from 1 to N threads.
+// The binary itself is agent-agnostic: run it plain for the glibc
+// baseline and with LD_PRELOAD=agent.so / advanced_agent.so to measure
+// each agent (see `make bench`).
+//
+// Usage: hook_bench [--iters N] [--threads N] [--json FILE] [--label NAME]
+
+#include <pthread.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include "bench_util.h"
+
+static const size_t SIZE_CLASSES[] = {16, 64, 256, 1024, 4096, 65536, 1 << 20};
+static const int NUM_SIZE_CLASSES = sizeof(SIZE_CLASSES) / sizeof(SIZE_CLASSES[0]);
+
+// Live pointers kept per round; also bounds the agent's tracked set
+#define BATCH 256
+
+enum BenchOp { OP_MALLOC, OP_FREE, OP_REALLOC, OP_CALLOC, NUM_OPS };
+static const char* OP_NAMES[NUM_OPS] = {"malloc", "free", "realloc", "calloc"};
+
+static uint64_t timer_overhead_ns = 0;
+
+static inline uint64_t adjusted(uint64_t dt) {
+    return dt > timer_overhead_ns ? dt - timer_overhead_ns : 0;
+}
+
+// Time every single call of `op` for one size class
+static LatencySummary bench_op(BenchOp op, size_t size, int iters) {
+    std::vector<uint64_t> samples;
+    samples.reserve(iters);
+    void* ptrs[BATCH];
+
+    for (int done = 0; done < iters; done += BATCH) {
+        int n = std::min(BATCH, iters - done);
+
+        // Setup outside the timed region
+        if (op == OP_FREE || op == OP_REALLOC) {
+            for (int i = 0; i < n; i++) {
+                ptrs[i] = malloc(size);
+                bench_escape(ptrs[i]);
+            }
+        }
+
+        for (int i = 0; i < n; i++) {
+            uint64_t t0 = bench_now_ns();
+            switch (op) {
+            case OP_MALLOC:
+                ptrs[i] = malloc(size);
+                break;
+            case OP_FREE:
+                free(ptrs[i]);
+                break;
+            case OP_REALLOC:
+                ptrs[i] = realloc(ptrs[i], size * 2);
+                break;
+            case OP_CALLOC:
+                ptrs[i] = calloc(1, size);
+                break;
+            default:
+                break;
+            }
+            uint64_t t1 = bench_now_ns();
+            bench_escape(ptrs[i]);
+            samples.push_back(adjusted(t1 - t0));
+        }
+
+        if (op != OP_FREE) {
+            for (int i = 0; i < n; i++) free(ptrs[i]);
+        }
+    }
+
+    return summarize_latency(samples);
+}
+
+// Multithreaded scaling: each thread churns a small window of live blocks
+struct ScalingResult {
+    int threads;
+    double ops_per_sec;
+    double ns_per_op;
+};
+
+static void scaling_worker(int iters, std::atomic<int>* ready, std::atomic<bool>* go) {
+    void* window[64] = {};
+    ready->fetch_add(1);
+    while (!go->load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+
+    for (int i = 0; i < iters; i++) {
+        int slot = i & 63;
+        if (window[slot]) free(window[slot]);
+        window[slot] = malloc(SIZE_CLASSES[i % 4]);  // small-object mix
+        bench_escape(window[slot]);
+    }
+    for (void* p : window) free(p);
+}
+
+static ScalingResult bench_scaling(int threads, int iters) {
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back(scaling_worker, iters, &ready, &go);
+    }
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+
+    uint64_t t0 = bench_now_ns();
+    go.store(true, std::memory_order_release);
+    for (auto& w : workers) w.join();
+    uint64_t elapsed = bench_now_ns() - t0;
+
+    // One op = one malloc + one free
+    double total_ops = (double)threads * iters;
+    ScalingResult r;
+    r.threads = threads;
+    r.ops_per_sec = total_ops / (elapsed / 1e9);
+    r.ns_per_op = (double)elapsed * threads / total_ops;
+    return r;
+}
+
+int main(int argc, char** argv) {
+    int iters = atoi(bench_arg(argc, argv, "--iters", "100000"));
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = atoi(bench_arg(argc, argv, "--threads", std::to_string(ncpu > 0 ? ncpu : 1).c_str()));
+    const char* json_path = bench_arg(argc, argv, "--json", nullptr);
+    const char* label = bench_arg(argc, argv, "--label", detect_agent_name());
+
+    if (iters <= 0 || max_threads <= 0) {
+        fprintf(stderr, "Usage: %s [--iters N] [--threads N] [--json FILE] [--label NAME]\n", argv[0]);
+        return 1;
+    }
+
+    timer_overhead_ns = calibrate_timer_overhead_ns();
+
+    printf("=== HOOK OVERHEAD BENCHMARK (%s) ===\n", label);
+    printf("iterations/op: %d, timer overhead: %lu ns (subtracted)\n\n", iters, timer_overhead_ns);
+    printf("%-8s %9s %9s %8s %8s %8s %9s\n", "op", "size", "mean_ns", "p50", "p99", "p999", "max");
+
+    std::string json = "{\n  \"benchmark\": \"hook_bench\",\n";
+    json += "  \"label\": \"" + std::string(label) + "\",\n";
+    json += "  \"agent\": \"" + std::string(detect_agent_name()) + "\",\n";
+    json += "  \"iterations\": " + std::to_string(iters) + ",\n";
+    json += "  \"timer_overhead_ns\": " + std::to_string(timer_overhead_ns) + ",\n";
+    json += "  \"ops\": [\n";
+
+    bool first = true;
+    for (int op = 0; op < NUM_OPS; op++) {
+        for (int s = 0; s < NUM_SIZE_CLASSES; s++) {
+            size_t size = SIZE_CLASSES[s];
+            // Fewer iterations for the mmap-backed classes
+            int n = size >= 65536 ? std::max(iters / 20, 1) : iters;
+            LatencySummary r = bench_op((BenchOp)op, size, n);
+
+            printf("%-8s %9zu %9.1f %8lu %8lu %8lu %9lu\n",
+                   OP_NAMES[op], size, r.mean_ns, r.p50_ns, r.p99_ns, r.p999_ns, r.max_ns);
+
+            if (!first) json += ",\n";
+            first = false;
+            json += "    {\"op\": \"" + std::string(OP_NAMES[op]) + "\", \"size\": " + std::to_string(size) + ", ";
+            append_latency_json(json, r);
+            json += "}";
+        }
+    }
+    json += "\n  ],\n  \"scaling\": [\n";
+
+    printf("\n%-8s %14s %10s %8s\n", "threads", "ops/sec", "ns/op", "speedup");
+    double base_rate = 0;
+    first = true;
+    std::vector<int> thread_counts;
+    for (int t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    for (int t : thread_counts) {
+        ScalingResult r = bench_scaling(t, iters);
+        if (t == 1) base_rate = r.ops_per_sec;
+        double speedup = base_rate > 0 ? r.ops_per_sec / base_rate : 0;
+        printf("%-8d %14.0f %10.1f %8.2f\n", r.threads, r.ops_per_sec, r.ns_per_op, speedup);
+
+        char buf[192];
+        snprintf(buf, sizeof(buf),
+                 "    {\"threads\": %d, \"ops_per_sec\": %.0f, \"ns_per_op\": %.1f, \"speedup\": %.3f}",
+                 r.threads, r.ops_per_sec, r.ns_per_op, speedup);
+        if (!first) json += ",\n";
+        first = false;
+        json += buf;
+    }
+    json += "\n  ]\n}\n";
+
+    if (json_path) {
+        if (!write_text_file(json_path, json)) return 1;
+        printf("\nJSON results written to %s\n", json_path);
+    }
+    return 0;
+}
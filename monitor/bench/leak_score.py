@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+"""
+Leak detector scoring over the labeled scenario corpus
+======================================================
+
+Runs every `test_app scenario NAME` once without an agent (CPU baseline)
+and once per detector configuration under the advanced agent, then
+scores the agent's leak reports against the labels the scenario writes:
+
+- precision: reported objects that are labeled leaks / all distinct
+  reported objects (labeled benign and unlabeled reports are false
+  positives)
+- recall:    labeled leaks reported at least once / labeled leaks
+- latency:   first report time - time the object became a leak
+- agent CPU: process CPU time minus the no-agent baseline
+
+Reports are read from the agent's "[LEAK] 0x..." stderr lines and
+stamped on arrival with time.monotonic_ns(), the same CLOCK_MONOTONIC
+the scenario labels use. The stderr stream is lossless, unlike the
+1000-slot ring. A configuration is `name:scan_ms=N,staleness=SECONDS`.
+
+Usage: leak_score.py [--app PATH] [--scenarios a,b] [--config SPEC]...
+                     [--duration-ms MS] [--json FILE]
+"""
+
+import argparse
+import bisect
+import json
+import os
+import re
+import resource
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+MONITOR_DIR = os.path.dirname(BENCH_DIR)
+DEFAULT_APP = os.path.join(MONITOR_DIR, '..', 'target_app', 'test_app')
+AGENT = os.path.join(MONITOR_DIR, 'advanced_agent.so')
+
+SCENARIOS = ['slow_drip', 'bursty', 'cache_growth', 'hidden_in_churn',
+             'cross_thread', 'fragmentation', 'singleton']
+DEFAULT_CONFIGS = ['fast:scan_ms=500,staleness=1',
+                   'balanced:scan_ms=1000,staleness=3',
+                   'default:scan_ms=5000,staleness=3']
+
+LEAK_LINE = re.compile(r'\[LEAK\] (0x[0-9a-f]+):')
+
+
+def parse_config(spec):
+    name, _, params = spec.partition(':')
+    config = {'name': name, 'scan_ms': 5000, 'staleness': 3.0}
+    for item in filter(None, params.split(',')):
+        key, _, value = item.partition('=')
+        if key not in ('scan_ms', 'staleness'):
+            raise ValueError(f"unknown detector parameter '{key}' in '{spec}'")
+        config[key] = float(value) if key == 'staleness' else int(value)
+    return config
+
+
+def children_cpu_s():
+    ru = resource.getrusage(resource.RUSAGE_CHILDREN)
+    return ru.ru_utime + ru.ru_stime
+
+
+def run_scenario(app, scenario, duration_ms, tail_ms, config=None):
+    """Runs one scenario; returns (labels, {address: [report ns, ...]}, cpu seconds)"""
+    env = dict(os.environ)
+    env.pop('LD_PRELOAD', None)
+    if config:
+        env['LD_PRELOAD'] = AGENT
+        env['LEAK_SCAN_INTERVAL_MS'] = str(config['scan_ms'])
+        env['LEAK_STALENESS_SECONDS'] = str(config['staleness'])
+
+    with tempfile.NamedTemporaryFile(suffix='.csv', delete=False) as f:
+        labels_path = f.name
+    reports = {}
+
+    def read_reports(stream):
+        for line in stream:
+            m = LEAK_LINE.search(line)
+            if m:
+                reports.setdefault(int(m.group(1), 16), []).append(time.monotonic_ns())
+
+    cpu0 = children_cpu_s()
+    proc = subprocess.Popen([app, 'scenario', scenario, '--duration-ms', str(duration_ms),
+                             '--tail-ms', str(tail_ms), '--labels', labels_path],
+                            env=env, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    reader = threading.Thread(target=read_reports, args=(proc.stderr,))
+    reader.start()
+    proc.wait()
+    reader.join()
+    cpu = children_cpu_s() - cpu0
+
+    labels = []
+    try:
+        with open(labels_path) as f:
+            next(f, None)
+            for line in f:
+                address, label, t_alloc, t_leak, t_free = line.strip().split(',')
+                labels.append((int(address, 16), label, int(t_alloc), int(t_leak), int(t_free)))
+    finally:
+        os.unlink(labels_path)
+    if proc.returncode != 0:
+        raise RuntimeError(f"{scenario} exited with {proc.returncode}")
+    return labels, reports, cpu
+
+
+def score(labels, reports):
+    """Matches every report to the labeled object alive at its time
+
+    An address can be reused, so each report is matched on its own and the
+    results are counted per object: a leak counts once, with the latency of
+    its first report.
+    """
+    by_address = {}
+    for label in labels:
+        by_address.setdefault(label[0], []).append(label)
+    for objects in by_address.values():
+        objects.sort(key=lambda lab: lab[2])
+
+    first_report = {}  # (address, object index) -> first report ns
+    unlabeled = set()
+    for address, times in reports.items():
+        objects = by_address.get(address, [])
+        starts = [lab[2] for lab in objects]
+        for t_report in times:
+            i = bisect.bisect_right(starts, t_report) - 1
+            if i < 0 or (objects[i][4] and objects[i][4] <= t_report):
+                unlabeled.add(address)  # no object, or freed before the report: the address was reused
+                continue
+            first_report.setdefault((address, i), t_report)
+
+    tp = fp_benign = 0
+    latencies = []
+    for (address, i), t_report in first_report.items():
+        match = by_address[address][i]
+        if match[1] == 'leak':
+            tp += 1
+            latencies.append(t_report - match[3])
+        else:
+            fp_benign += 1
+    fp_unlabeled = len(unlabeled)
+
+    leaks = sum(1 for lab in labels if lab[1] == 'leak')
+    reported = tp + fp_benign + fp_unlabeled
+    latencies.sort()
+    return {
+        'leaks': leaks,
+        'reported': reported,
+        'true_positives': tp,
+        'false_positives_benign': fp_benign,
+        'false_positives_unlabeled': fp_unlabeled,
+        'precision': round(tp / reported, 4) if reported else None,
+        'recall': round(tp / leaks, 4) if leaks else None,
+        'latency_p50_ms': round(latencies[len(latencies) // 2] / 1e6, 1) if latencies else None,
+        'latency_max_ms': round(latencies[-1] / 1e6, 1) if latencies else None,
+    }
+
+
+def fmt(value, spec):
+    return '-' if value is None else format(value, spec)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Score leak detector configurations on labeled scenarios')
+    parser.add_argument('--app', default=DEFAULT_APP, help='test_app binary')
+    parser.add_argument('--scenarios', default=','.join(SCENARIOS))
+    parser.add_argument('--config', action='append', help='name:scan_ms=N,staleness=SECONDS (repeatable)')
+    parser.add_argument('--duration-ms', type=int, default=6000, help='active part of each scenario')
+    parser.add_argument('--json', help='write results to this file')
+    args = parser.parse_args()
+
+    try:
+        configs = [parse_config(spec) for spec in (args.config or DEFAULT_CONFIGS)]
+    except ValueError as e:
+        print(e, file=sys.stderr)
+        return 1
+    if not os.access(args.app, os.X_OK):
+        print(f"{args.app}: not built (make -C monitor test-app)", file=sys.stderr)
+        return 1
+
+    results = []
+    print(f"{'scenario':<16} {'config':<10} {'leaks':>6} {'rep':>6} {'prec':>6} {'recall':>6} "
+          f"{'lat_p50':>8} {'lat_max':>8} {'agent_cpu':>9}")
+    for scenario in args.scenarios.split(','):
+        _, _, base_cpu = run_scenario(args.app, scenario, args.duration_ms, 0)
+        for config in configs:
+            # Long enough for the last leak to go stale and be scanned twice
+            tail_ms = int(config['staleness'] * 1000 + 2 * config['scan_ms'])
+            labels, reports, cpu = run_scenario(args.app, scenario, args.duration_ms, tail_ms, config)
+            r = score(labels, reports)
+            r.update({'scenario': scenario, 'config': config['name'], 'scan_ms': config['scan_ms'],
+                      'staleness_s': config['staleness'], 'cpu_s': round(cpu, 3),
+                      'baseline_cpu_s': round(base_cpu, 3), 'agent_cpu_s': round(cpu - base_cpu, 3)})
+            results.append(r)
+            print(f"{scenario:<16} {config['name']:<10} {r['leaks']:>6} {r['reported']:>6} "
+                  f"{fmt(r['precision'], '.2f'):>6} {fmt(r['recall'], '.2f'):>6} "
+                  f"{fmt(r['latency_p50_ms'], '.0f'):>8} {fmt(r['latency_max_ms'], '.0f'):>8} "
+                  f"{r['agent_cpu_s']:>8.2f}s")
+
+    print("\nlatency in ms from the moment an object became a leak to its first report")
+    report = {
+        'benchmark': 'leak_score',
+        'duration_ms': args.duration_ms,
+        'configs': configs,
+        'results': results,
+    }
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(report, f, indent=2)
+        print(f"JSON results written to {args.json}")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,164 @@
+// Per-allocation memory overhead benchmark
+// ========================================
+//
+// Keeps N allocations live from a realistic size distribution and
+// reports what each live allocation costs on top of the bytes the
+// application asked for:
+//   - heap: glibc in-use bytes (mallinfo2), which includes the agent's
+//     per-allocation header and malloc's own chunk rounding
+//   - rss:  resident set growth of the process
+//   - the agent's declared layout (get_agent_memory_layout): header
+//     bytes, registry bytes and shared memory bytes
+//
+// With --max-overhead BYTES the run fails when any distribution's heap
+// overhead per live allocation exceeds the budget, so `make
+// bench-memory` doubles as a regression check.
+//
+// Usage: memory_bench [--live N] [--max-overhead BYTES] [--json FILE]
+
+#include <dlfcn.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <random>
+#include "bench_util.h"
+
+typedef void (*get_layout_fn)(uint64_t*, uint64_t*, uint64_t*, uint64_t*);
+
+struct SizeBand {
+    double weight;
+    size_t lo, hi;
+};
+
+struct Distribution {
+    const char* name;
+    std::vector<SizeBand> bands;
+};
+
+// Small-object tail dominates counts, rare large buffers dominate bytes
+static const Distribution DISTRIBUTIONS[] = {
+    {"small_16_64", {{1.0, 16, 64}}},
+    {"mixed", {{0.70, 16, 64}, {0.20, 65, 1024}, {0.099, 1025, 65536}, {0.001, 1 << 20, 4 << 20}}},
+};
+
+static size_t heap_in_use() {
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+}
+
+static size_t rss_bytes() {
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long size = 0, resident = 0;
+    if (fscanf(f, "%lu %lu", &size, &resident) != 2) resident = 0;
+    fclose(f);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+static size_t draw_size(const Distribution& d, std::mt19937_64& rng) {
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    double r = u(rng);
+    for (const SizeBand& b : d.bands) {
+        if (r < b.weight) return std::uniform_int_distribution<size_t>(b.lo, b.hi)(rng);
+        r -= b.weight;
+    }
+    const SizeBand& last = d.bands.back();
+    return std::uniform_int_distribution<size_t>(last.lo, last.hi)(rng);
+}
+
+int main(int argc, char** argv) {
+    size_t live = strtoull(bench_arg(argc, argv, "--live", "100000"), nullptr, 10);
+    double max_overhead = atof(bench_arg(argc, argv, "--max-overhead", "0"));
+    const char* json_path = bench_arg(argc, argv, "--json", nullptr);
+
+    if (live == 0) {
+        fprintf(stderr, "Usage: %s [--live N] [--max-overhead BYTES] [--json FILE]\n", argv[0]);
+        return 1;
+    }
+
+    uint64_t header = 0, registry_entry = 0, registry_fixed = 0, shm = 0;
+    get_layout_fn get_layout = (get_layout_fn)dlsym(RTLD_DEFAULT, "get_agent_memory_layout");
+    if (get_layout) get_layout(&header, &registry_entry, &registry_fixed, &shm);
+
+    printf("=== PER-ALLOCATION MEMORY OVERHEAD (%s) ===\n", detect_agent_name());
+    printf("agent layout: header %lu B/alloc, registry %lu B/entry + %lu B fixed, shm %lu B\n\n",
+           header, registry_entry, registry_fixed, shm);
+    printf("%-12s %9s %12s %10s %10s %10s %10s\n", "distribution", "live", "requested",
+           "avg_size", "heap_ovh", "rss_ovh", "fixed_ovh");
+
+    std::string json = "{\n  \"benchmark\": \"memory_bench\",\n";
+    json += "  \"agent\": \"" + std::string(detect_agent_name()) + "\",\n";
+    char buf[512];
+    snprintf(buf, sizeof(buf),
+             "  \"layout\": {\"header_bytes\": %lu, \"registry_entry_bytes\": %lu, "
+             "\"registry_fixed_bytes\": %lu, \"shm_bytes\": %lu},\n",
+             header, registry_entry, registry_fixed, shm);
+    json += buf;
+    json += "  \"distributions\": [\n";
+
+    bool over_budget = false;
+    std::vector<void*> ptrs;
+    ptrs.reserve(live);
+
+    for (size_t d = 0; d < sizeof(DISTRIBUTIONS) / sizeof(DISTRIBUTIONS[0]); d++) {
+        const Distribution& dist = DISTRIBUTIONS[d];
+        std::mt19937_64 rng(1234 + d);
+
+        malloc_trim(0);
+        size_t heap0 = heap_in_use();
+        size_t rss0 = rss_bytes();
+
+        size_t requested = 0;
+        for (size_t i = 0; i < live; i++) {
+            size_t size = draw_size(dist, rng);
+            void* p = malloc(size);
+            if (!p) {
+                fprintf(stderr, "malloc(%zu) failed after %zu allocations\n", size, i);
+                return 1;
+            }
+            memset(p, 0x5A, size);  // resident, like real data
+            ptrs.push_back(p);
+            requested += size;
+        }
+
+        size_t heap_delta = heap_in_use() - heap0;
+        size_t rss_delta = rss_bytes() - rss0;
+        double heap_ovh = ((double)heap_delta - requested) / live;
+        double rss_ovh = ((double)rss_delta - requested) / live;
+        // Registry entries in use (capped by a fixed-size table) plus the
+        // shm segment, amortized over this live set
+        uint64_t registry_used = live * registry_entry;
+        if (registry_fixed && registry_used > registry_fixed) registry_used = registry_fixed;
+        double fixed_ovh = (double)(registry_used + shm) / live;
+
+        printf("%-12s %9zu %12zu %10.1f %10.1f %10.1f %10.2f\n", dist.name, live, requested,
+               (double)requested / live, heap_ovh, rss_ovh, fixed_ovh);
+
+        if (d) json += ",\n";
+        snprintf(buf, sizeof(buf),
+                 "    {\"name\": \"%s\", \"live\": %zu, \"requested_bytes\": %zu, \"heap_bytes\": %zu, "
+                 "\"rss_bytes\": %zu,\n     \"heap_overhead_per_alloc\": %.2f, \"rss_overhead_per_alloc\": %.2f, "
+                 "\"header_bytes_per_alloc\": %lu, \"registry_bytes_per_alloc\": %.2f, "
+                 "\"shm_bytes_per_alloc\": %.4f}",
+                 dist.name, live, requested, heap_delta, rss_delta, heap_ovh, rss_ovh,
+                 header, (double)registry_used / live, (double)shm / live);
+        json += buf;
+
+        if (max_overhead > 0 && heap_ovh > max_overhead) {
+            fprintf(stderr, "❌ %s: heap overhead %.1f B/alloc exceeds budget %.1f B\n",
+                    dist.name, heap_ovh, max_overhead);
+            over_budget = true;
+        }
+
+        for (void* p : ptrs) free(p);
+        ptrs.clear();
+    }
+    json += "\n  ]\n}\n";
+
+    printf("\nheap_ovh/rss_ovh = bytes per live allocation beyond the requested size\n");
+
+    if (json_path) {
+        if (!write_text_file(json_path, json)) return 1;
+        printf("JSON results written to %s\n", json_path);
+    }
+    return over_budget ? 2 : 0;
+}
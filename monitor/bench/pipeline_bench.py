@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+"""
+End-to-end pipeline benchmark: agent -> shared memory ring -> consumer
+======================================================================
+
+For every (agent, consumer) pair this starts pipeline_load under
+LD_PRELOAD, drains the agent's ring with the consumer and reports
+sustained events/sec, drop rate and publish-to-consume latency.
+
+Consumers:
+- native:  bench/ring_consumer (separate process)
+- python:  the analyzers' own read paths (analyzer.py for the basic
+           ring, advanced_analyzer.py for the advanced ring), in-process
+
+Every record carries the CLOCK_MONOTONIC time it was published, which
+time.monotonic_ns() reads on the same clock.
+"""
+
+import argparse
+import io
+import json
+import os
+import subprocess
+import sys
+import time
+from contextlib import redirect_stderr, redirect_stdout
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+MONITOR_DIR = os.path.dirname(BENCH_DIR)
+sys.path.insert(0, MONITOR_DIR)
+
+from analyzer import SharedMemoryAnalyzer  # noqa: E402
+from advanced_analyzer import AdvancedLeakAnalyzer  # noqa: E402
+
+AGENTS = {
+    'agent': ('agent.so', 'basic', '/dev/shm/ml_runtime_shm'),
+    'advanced_agent': ('advanced_agent.so', 'advanced', '/dev/shm/ml_advanced_leak_detection'),
+}
+
+
+def summarize(latencies):
+    """Same percentile definition as bench_util.h"""
+    if not latencies:
+        return {'count': 0}
+    latencies.sort()
+    n = len(latencies)
+
+    def pct(q):
+        return latencies[int(q * (n - 1))]
+
+    return {
+        'count': n,
+        'mean_ns': round(sum(latencies) / n, 1),
+        'p50_ns': pct(0.50),
+        'p90_ns': pct(0.90),
+        'p99_ns': pct(0.99),
+        'p999_ns': pct(0.999),
+        'max_ns': latencies[-1],
+    }
+
+
+def connect_with_retry(connect, attempts=50, delay=0.1):
+    """The ring may exist but not be sized yet while the agent starts"""
+    with redirect_stdout(io.StringIO()), redirect_stderr(io.StringIO()):
+        for _ in range(attempts):
+            if connect():
+                return True
+            time.sleep(delay)
+    return False
+
+
+def python_consume_basic(poll_s, idle_exit_s):
+    analyzer = SharedMemoryAnalyzer()
+    if not connect_with_retry(lambda: analyzer.connect_shared_memory(retries=1)):
+        return None
+
+    def write_index():
+        analyzer.shm.seek(0)
+        return analyzer.header_struct.unpack(analyzer.shm.read(analyzer.header_struct.size))[0]
+
+    start = analyzer.last_read_index = write_index()
+    return drain(analyzer.buffer_size, write_index,
+                 lambda: analyzer.last_read_index,
+                 lambda pos: setattr(analyzer, 'last_read_index', pos),
+                 lambda: [a['publish_ns'] for a in analyzer.read_new_allocations()],
+                 start, poll_s, idle_exit_s, analyzer.shm.close)
+
+
+def python_consume_advanced(poll_s, idle_exit_s):
+    analyzer = AdvancedLeakAnalyzer()
+    if not connect_with_retry(lambda: analyzer.connect_to_shared_memory(retries=1)):
+        return None
+
+    state = {'pos': analyzer.read_buffer_header()[0]}
+
+    def read_batch():
+        # Same loop as AdvancedLeakAnalyzer.monitor_real_time()
+        write_index = analyzer.read_buffer_header()[0]
+        stamps = []
+        while state['pos'] != write_index:
+            event = analyzer.read_leak_event(state['pos'] % 1000)
+            if event:
+                stamps.append(event.timestamp)
+            state['pos'] += 1
+        return stamps
+
+    return drain(1000, lambda: analyzer.read_buffer_header()[0],
+                 lambda: state['pos'], lambda pos: state.__setitem__('pos', pos),
+                 read_batch, state['pos'], poll_s, idle_exit_s, analyzer.cleanup)
+
+
+def drain(capacity, write_index, get_pos, set_pos, read_batch, start, poll_s, idle_exit_s, close):
+    latencies = []
+    dropped = invalid = 0
+    first = last = None
+    last_progress = time.monotonic()
+
+    while True:
+        w = write_index()
+        if w - get_pos() > capacity:
+            dropped += w - get_pos() - capacity
+            set_pos(w - capacity)
+
+        if get_pos() == w:
+            if time.monotonic() - last_progress > idle_exit_s:
+                break
+            time.sleep(poll_s)
+            continue
+
+        stamps = read_batch()
+        now = time.monotonic_ns()
+        for ts in stamps:
+            if ts == 0 or ts > now:
+                invalid += 1
+                continue
+            latencies.append(now - ts)
+        if stamps:
+            first = first or now
+            last = now
+        last_progress = time.monotonic()
+
+    published = get_pos() - start
+    close()
+    consumed = len(latencies)
+    span = (last - first) / 1e9 if first and last and last > first else 0
+    return {
+        'published': published,
+        'consumed': consumed,
+        'dropped': dropped,
+        'invalid': invalid,
+        'drop_rate': round(dropped / published, 6) if published else 0.0,
+        'events_per_sec': round(consumed / span) if span else 0,
+        'latency': summarize(latencies),
+    }
+
+
+def run_pair(agent, consumer, args):
+    so_name, ring, shm_path = AGENTS[agent]
+    if os.path.exists(shm_path):
+        os.unlink(shm_path)
+
+    env = dict(os.environ, LD_PRELOAD=os.path.join(MONITOR_DIR, so_name))
+    load_cmd = [os.path.join(BENCH_DIR, 'pipeline_load'),
+                '--rate', str(args.rate), '--duration-ms', str(args.duration_ms),
+                '--threads', str(args.threads), '--start-delay-ms', '500']
+    load = subprocess.Popen(load_cmd, env=env, stdout=subprocess.PIPE,
+                            stderr=subprocess.DEVNULL, text=True)
+
+    idle_exit_s = 1.0
+    if consumer == 'native':
+        out = subprocess.run([os.path.join(BENCH_DIR, 'ring_consumer'), '--ring', ring,
+                              '--poll-us', str(args.poll_us),
+                              '--idle-exit-ms', str(int(idle_exit_s * 1000))],
+                             stdout=subprocess.PIPE, text=True).stdout
+        result = json.loads(out.strip().splitlines()[-1]) if out.strip() else None
+    elif ring == 'basic':
+        result = python_consume_basic(args.poll_us / 1e6, idle_exit_s)
+    else:
+        result = python_consume_advanced(args.poll_us / 1e6, idle_exit_s)
+
+    load_out, _ = load.communicate()
+    load_stats = {}
+    for line in load_out.splitlines():
+        if line.startswith('{'):
+            load_stats = json.loads(line)
+
+    if result is None:
+        return {'agent': agent, 'consumer': consumer, 'error': 'could not attach to ring'}
+
+    result.update(load_stats)
+    result['agent'] = agent
+    result['consumer'] = consumer
+    result['ring'] = ring
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Agent -> ring -> consumer pipeline benchmark')
+    parser.add_argument('--rate', type=int, default=100000, help='target allocation ops/sec (0 = max)')
+    parser.add_argument('--duration-ms', type=int, default=2000)
+    parser.add_argument('--threads', type=int, default=1)
+    parser.add_argument('--poll-us', type=int, default=100, help='consumer poll interval when idle')
+    parser.add_argument('--agents', default='agent,advanced_agent')
+    parser.add_argument('--consumers', default='native,python')
+    parser.add_argument('--json', help='write results to this file')
+    args = parser.parse_args()
+
+    results = []
+    print(f"{'agent':<16} {'consumer':<8} {'published':>10} {'ev/s':>10} {'drop%':>7} "
+          f"{'p50_ns':>10} {'p99_ns':>10} {'p999_ns':>10}")
+    for agent in args.agents.split(','):
+        for consumer in args.consumers.split(','):
+            r = run_pair(agent, consumer, args)
+            results.append(r)
+            if 'error' in r:
+                print(f"{agent:<16} {consumer:<8} ERROR: {r['error']}")
+                continue
+            lat = r['latency']
+            print(f"{agent:<16} {consumer:<8} {r['published']:>10} {r['events_per_sec']:>10} "
+                  f"{r['drop_rate'] * 100:>6.2f}% {lat.get('p50_ns', 0):>10} "
+                  f"{lat.get('p99_ns', 0):>10} {lat.get('p999_ns', 0):>10}")
+
+    report = {
+        'benchmark': 'pipeline_bench',
+        'rate': args.rate,
+        'duration_ms': args.duration_ms,
+        'threads': args.threads,
+        'poll_us': args.poll_us,
+        'results': results,
+    }
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(report, f, indent=2)
+        print(f"\nJSON results written to {args.json}")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,84 @@
+// Synthetic allocation load for the pipeline benchmark
+// ====================================================
+//
+// Runs under LD_PRELOAD=agent.so / advanced_agent.so and issues
+// malloc+free pairs at a target rate so the agent publishes a steady
+// event stream into its shared memory ring.
+//
+// Usage: pipeline_load [--rate OPS_PER_SEC] [--duration-ms N] [--threads N]
+//                      [--start-delay-ms N] [--size BYTES]
+//        --rate 0 means "as fast as possible".
+
+#include <atomic>
+#include <thread>
+#include "bench_util.h"
+
+static void load_worker(double rate, uint64_t start_ns, uint64_t end_ns, size_t size,
+                        std::atomic<uint64_t>* ops_done) {
+    uint64_t period_ns = rate > 0 ? (uint64_t)(1e9 / rate) : 0;
+    void* window[16] = {};
+    uint64_t ops = 0;
+
+    for (;;) {
+        uint64_t now = bench_now_ns();
+        if (now >= end_ns) break;
+
+        if (period_ns) {
+            uint64_t due = start_ns + ops * period_ns;
+            if (due > now) {
+                // Sleep when far ahead, otherwise spin for precision
+                // (below ~1 op/s the gap exceeds a second: split it, and
+                // don't sleep past the end of the run)
+                uint64_t wake = due < end_ns ? due : end_ns;
+                if (wake > now && wake - now > 50000) {
+                    uint64_t delay = wake - now - 20000;
+                    struct timespec ts = {(time_t)(delay / 1000000000ULL), (long)(delay % 1000000000ULL)};
+                    nanosleep(&ts, nullptr);
+                }
+                continue;
+            }
+        }
+
+        int slot = ops & 15;
+        if (window[slot]) free(window[slot]);
+        window[slot] = malloc(size);
+        bench_escape(window[slot]);
+        ops++;
+    }
+
+    for (void* p : window) free(p);
+    ops_done->fetch_add(ops);
+}
+
+int main(int argc, char** argv) {
+    double rate = atof(bench_arg(argc, argv, "--rate", "100000"));
+    uint64_t duration_ms = strtoull(bench_arg(argc, argv, "--duration-ms", "2000"), nullptr, 10);
+    int threads = atoi(bench_arg(argc, argv, "--threads", "1"));
+    uint64_t delay_ms = strtoull(bench_arg(argc, argv, "--start-delay-ms", "300"), nullptr, 10);
+    size_t size = strtoull(bench_arg(argc, argv, "--size", "128"), nullptr, 10);
+
+    if (threads <= 0 || rate < 0) {
+        fprintf(stderr, "Usage: %s [--rate N] [--duration-ms N] [--threads N] [--start-delay-ms N] [--size N]\n",
+                argv[0]);
+        return 1;
+    }
+
+    // Give the consumer time to attach to the freshly created ring
+    struct timespec delay = {(time_t)(delay_ms / 1000), (long)(delay_ms % 1000) * 1000000L};
+    nanosleep(&delay, nullptr);
+
+    std::atomic<uint64_t> ops_done{0};
+    uint64_t start = bench_now_ns();
+    uint64_t end = start + duration_ms * 1000000ULL;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back(load_worker, rate / threads, start, end, size, &ops_done);
+    }
+    for (auto& w : workers) w.join();
+
+    uint64_t elapsed = bench_now_ns() - start;
+    printf("{\"load_ops\": %lu, \"load_ops_per_sec\": %.0f}\n",
+           ops_done.load(), ops_done.load() / (elapsed / 1e9));
+    return 0;
+}
@@ -0,0 +1,154 @@
+// Native ring consumer for the pipeline benchmark
+// ===============================================
+//
+// Attaches read-only to an agent's shared memory ring, drains it and
+// reports sustained events/sec, drops (records overwritten before they
+// were read) and publish-to-consume latency percentiles as one JSON line.
+//
+// Usage: ring_consumer --ring basic|advanced [--poll-us N]
+//                      [--attach-timeout-ms N] [--idle-exit-ms N]
+
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "bench_util.h"
+#include "../shm_layout.h"
+
+struct RingView {
+    const char* name;
+    size_t map_size;
+    int capacity;
+    const volatile int* write_index;
+    // Returns false when the slot holds no valid record
+    bool (*read_publish_ns)(const void* base, int slot, uint64_t* publish_ns);
+};
+
+static bool basic_read(const void* base, int slot, uint64_t* publish_ns) {
+    const SharedBuffer* buf = (const SharedBuffer*)base;
+    AllocationData rec;
+    memcpy(&rec, (const void*)&buf->allocations[slot], sizeof(rec));
+    *publish_ns = rec.publish_ns;
+    return rec.is_valid == 1;
+}
+
+static bool advanced_read(const void* base, int slot, uint64_t* publish_ns) {
+    const LeakDetectionBuffer* buf = (const LeakDetectionBuffer*)base;
+    LeakEvent ev;
+    memcpy(&ev, (const void*)&buf->events[slot], sizeof(ev));
+    *publish_ns = ev.timestamp;
+    return ev.is_valid == 1;
+}
+
+static void* attach(const char* name, size_t size, uint64_t timeout_ms) {
+    uint64_t deadline = bench_now_ns() + timeout_ms * 1000000ULL;
+    while (bench_now_ns() < deadline) {
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd != -1) {
+            struct stat st;
+            // The agent creates the object before sizing it
+            if (fstat(fd, &st) == 0 && (size_t)st.st_size >= size) {
+                void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+                close(fd);
+                return p == MAP_FAILED ? nullptr : p;
+            }
+            close(fd);
+        }
+        usleep(1000);
+    }
+    return nullptr;
+}
+
+int main(int argc, char** argv) {
+    std::string ring = bench_arg(argc, argv, "--ring", "advanced");
+    useconds_t poll_us = atoi(bench_arg(argc, argv, "--poll-us", "100"));
+    uint64_t attach_timeout_ms = strtoull(bench_arg(argc, argv, "--attach-timeout-ms", "5000"), nullptr, 10);
+    uint64_t idle_exit_ms = strtoull(bench_arg(argc, argv, "--idle-exit-ms", "1000"), nullptr, 10);
+
+    RingView view;
+    if (ring == "basic") {
+        view = {BASIC_SHM_NAME, sizeof(SharedBuffer), BUFFER_SIZE, nullptr, basic_read};
+    } else if (ring == "advanced") {
+        view = {ADVANCED_SHM_NAME, sizeof(LeakDetectionBuffer), LEAK_BUFFER_SIZE, nullptr, advanced_read};
+    } else {
+        fprintf(stderr, "Usage: %s --ring basic|advanced [--poll-us N] [--idle-exit-ms N]\n", argv[0]);
+        return 1;
+    }
+
+    void* base = attach(view.name, view.map_size, attach_timeout_ms);
+    if (!base) {
+        fprintf(stderr, "ring_consumer: cannot attach to %s\n", view.name);
+        return 1;
+    }
+    // write_index is the first field of both layouts
+    view.write_index = (const volatile int*)base;
+
+    std::vector<uint64_t> latencies;
+    latencies.reserve(1 << 20);
+
+    int start_index = __atomic_load_n(view.write_index, __ATOMIC_ACQUIRE);
+    int pos = start_index;
+    uint64_t consumed = 0, dropped = 0, invalid = 0;
+    uint64_t first_ns = 0, last_ns = 0;
+    uint64_t last_progress = bench_now_ns();
+
+    for (;;) {
+        int w = __atomic_load_n(view.write_index, __ATOMIC_ACQUIRE);
+
+        // Lapped by the producer: everything older than one ring is gone
+        if (w - pos > view.capacity) {
+            dropped += (uint64_t)(w - pos - view.capacity);
+            pos = w - view.capacity;
+        }
+
+        if (pos == w) {
+            if (bench_now_ns() - last_progress > idle_exit_ms * 1000000ULL) break;
+            if (poll_us) usleep(poll_us);
+            else sched_yield();
+            continue;
+        }
+
+        while (pos < w) {
+            uint64_t publish_ns;
+            bool valid = view.read_publish_ns(base, pos % view.capacity, &publish_ns);
+            uint64_t now = bench_now_ns();
+
+            // Overwritten while we were copying it
+            int w_after = __atomic_load_n(view.write_index, __ATOMIC_ACQUIRE);
+            if (w_after - pos >= view.capacity) {
+                dropped++;
+            } else if (!valid || publish_ns == 0 || publish_ns > now) {
+                invalid++;
+            } else {
+                latencies.push_back(now - publish_ns);
+                consumed++;
+                if (!first_ns) first_ns = now;
+                last_ns = now;
+            }
+            pos++;
+        }
+        last_progress = bench_now_ns();
+    }
+
+    uint64_t published = (uint64_t)(pos - start_index);
+    LatencySummary lat = summarize_latency(latencies);
+    double span_s = last_ns > first_ns ? (last_ns - first_ns) / 1e9 : 0;
+
+    std::string json = "{\"consumer\": \"native\", \"ring\": \"" + ring + "\", ";
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "\"published\": %lu, \"consumed\": %lu, \"dropped\": %lu, \"invalid\": %lu, "
+             "\"drop_rate\": %.6f, \"events_per_sec\": %.0f, ",
+             published, consumed, dropped, invalid,
+             published ? (double)dropped / published : 0.0,
+             span_s > 0 ? consumed / span_s : 0.0);
+    json += buf;
+    json += "\"latency\": {";
+    append_latency_json(json, lat);
+    json += "}}";
+    printf("%s\n", json.c_str());
+
+    munmap(base, view.map_size);
+    return 0;
+}
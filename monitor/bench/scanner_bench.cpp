@@ -0,0 +1,201 @@
+// Leak-scanner scaling benchmark
+// ==============================
+//
+// Grows the live allocation set through 1000, 2000, 5000, 10000, ... up
+// to --max-live and at every level measures:
+//   - free() latency of random live blocks (untrack_allocation() cost)
+//   - scanner tick duration (advanced agent only, via get_scanner_stats)
+//   - malloc+free latency on the application thread with the scanner
+//     paused and then ticking every --scan-interval-ms, so the p99
+//     difference is the scanner-induced latency
+//
+// Run it under LD_PRELOAD=advanced_agent.so (see `make bench-scanner`);
+// without the advanced agent only the allocator-side numbers are reported.
+// The agent tracks a fixed number of allocations (MAX_TRACKED_ALLOCS):
+// a level it can't hold entirely would show a flat scan and free() cost,
+// so it is flagged ("saturated" in the JSON) and ends the run.
+//
+// Usage: scanner_bench [--max-live N] [--samples N] [--window-ms N]
+//                      [--scan-interval-ms N] [--json FILE]
+
+#include <dlfcn.h>
+#include <random>
+#include "bench_util.h"
+
+typedef void (*get_scanner_stats_fn)(uint64_t*, uint64_t*, uint64_t*, uint64_t*);
+typedef void (*set_scan_interval_fn)(uint64_t);
+typedef void (*reset_scanner_max_fn)();
+typedef void (*set_staleness_fn)(double);
+typedef void (*get_memory_layout_fn)(uint64_t*, uint64_t*, uint64_t*, uint64_t*);
+
+#define LIVE_BLOCK_SIZE 32
+
+struct ScannerSnapshot {
+    uint64_t scans, total_ns, max_ns, tracked;
+};
+
+static get_scanner_stats_fn get_scanner_stats = nullptr;
+static set_scan_interval_fn set_scan_interval_ms = nullptr;
+static reset_scanner_max_fn reset_scanner_max_ns = nullptr;
+
+static ScannerSnapshot scanner_snapshot() {
+    ScannerSnapshot s = {};
+    if (get_scanner_stats) get_scanner_stats(&s.scans, &s.total_ns, &s.max_ns, &s.tracked);
+    return s;
+}
+
+// 1-2-5 steps: several points below the tracker's capacity
+static uint64_t next_level(uint64_t level) {
+    uint64_t decade = 1;
+    while (decade * 10 <= level) decade *= 10;
+    return level / decade == 2 ? level / 2 * 5 : level * 2;
+}
+
+// Timed malloc+free pairs on the calling (application) thread
+static LatencySummary probe_app_latency(uint64_t window_ms, uint64_t timer_overhead) {
+    std::vector<uint64_t> samples;
+    samples.reserve(1 << 22);
+    uint64_t end = bench_now_ns() + window_ms * 1000000ULL;
+
+    while (bench_now_ns() < end && samples.size() < samples.capacity()) {
+        uint64_t t0 = bench_now_ns();
+        void* p = malloc(64);
+        bench_escape(p);
+        free(p);
+        uint64_t dt = bench_now_ns() - t0;
+        samples.push_back(dt > timer_overhead ? dt - timer_overhead : 0);
+    }
+    return summarize_latency(samples);
+}
+
+int main(int argc, char** argv) {
+    uint64_t max_live = strtoull(bench_arg(argc, argv, "--max-live", "5000"), nullptr, 10);
+    int samples = atoi(bench_arg(argc, argv, "--samples", "2000"));
+    uint64_t window_ms = strtoull(bench_arg(argc, argv, "--window-ms", "1000"), nullptr, 10);
+    uint64_t interval_ms = strtoull(bench_arg(argc, argv, "--scan-interval-ms", "100"), nullptr, 10);
+    const char* json_path = bench_arg(argc, argv, "--json", nullptr);
+
+    if (max_live < 1000 || samples <= 0 || interval_ms == 0) {
+        fprintf(stderr, "Usage: %s [--max-live N>=1000] [--samples N] [--window-ms N] "
+                        "[--scan-interval-ms N] [--json FILE]\n", argv[0]);
+        return 1;
+    }
+
+    get_scanner_stats = (get_scanner_stats_fn)dlsym(RTLD_DEFAULT, "get_scanner_stats");
+    set_scan_interval_ms = (set_scan_interval_fn)dlsym(RTLD_DEFAULT, "set_scan_interval_ms");
+    reset_scanner_max_ns = (reset_scanner_max_fn)dlsym(RTLD_DEFAULT, "reset_scanner_max_ns");
+    set_staleness_fn set_staleness = (set_staleness_fn)dlsym(RTLD_DEFAULT, "set_staleness_threshold_seconds");
+    bool has_scanner = get_scanner_stats && set_scan_interval_ms && reset_scanner_max_ns;
+
+    // Tracker capacity, 0 if unknown: the registry is a fixed array
+    uint64_t capacity = 0;
+    if (auto layout = (get_memory_layout_fn)dlsym(RTLD_DEFAULT, "get_agent_memory_layout")) {
+        uint64_t entry = 0, fixed = 0;
+        layout(nullptr, &entry, &fixed, nullptr);
+        capacity = entry ? fixed / entry : 0;
+    }
+    if (has_scanner && capacity && max_live >= capacity) {
+        printf("⚠️  The agent tracks at most %lu allocations: levels from there on are saturated\n", capacity);
+    }
+
+    if (has_scanner) {
+        set_scan_interval_ms(0);
+        // Measure the walk itself, not leak reporting
+        if (set_staleness) set_staleness(1e9);
+    }
+
+    uint64_t timer_overhead = calibrate_timer_overhead_ns();
+    std::mt19937_64 rng(42);
+    std::vector<void*> live;
+    live.reserve(max_live);
+
+    printf("=== LEAK SCANNER SCALING BENCHMARK (%s) ===\n", detect_agent_name());
+    printf("%10s %9s %9s %9s %9s %11s %11s %9s %9s\n", "live", "tracked", "free_p50", "free_p99",
+           "scans", "scan_avg_us", "scan_max_us", "app_p99", "app_p99*");
+
+    std::string json = "{\n  \"benchmark\": \"scanner_bench\",\n";
+    json += "  \"agent\": \"" + std::string(detect_agent_name()) + "\",\n";
+    json += "  \"scan_interval_ms\": " + std::to_string(interval_ms) + ",\n";
+    json += "  \"window_ms\": " + std::to_string(window_ms) + ",\n";
+    json += "  \"levels\": [\n";
+
+    bool first = true;
+    bool saturated = false;
+    for (uint64_t level = 1000, prev_level = 0; level <= max_live && !saturated;
+         prev_level = level, level = next_level(level)) {
+        // Populate up to this level (the set is never torn down: the
+        // agent's linear untrack would dominate runtime)
+        uint64_t t0 = bench_now_ns();
+        while (live.size() < level) {
+            void* p = malloc(LIVE_BLOCK_SIZE);
+            bench_escape(p);
+            live.push_back(p);
+        }
+        double populate_ns = (double)(bench_now_ns() - t0) / (level - prev_level);
+
+        // free() latency of random live blocks, replaced untimed
+        std::vector<uint64_t> free_samples;
+        free_samples.reserve(samples);
+        std::uniform_int_distribution<size_t> pick(0, live.size() - 1);
+        for (int i = 0; i < samples; i++) {
+            size_t idx = pick(rng);
+            uint64_t f0 = bench_now_ns();
+            free(live[idx]);
+            uint64_t dt = bench_now_ns() - f0;
+            free_samples.push_back(dt > timer_overhead ? dt - timer_overhead : 0);
+            live[idx] = malloc(LIVE_BLOCK_SIZE);
+        }
+        LatencySummary free_lat = summarize_latency(free_samples);
+
+        // Application latency with the scanner paused, then ticking
+        LatencySummary app_idle = probe_app_latency(window_ms, timer_overhead);
+        // max_ns is cumulative in the agent: restart it so it covers this level only
+        if (has_scanner) reset_scanner_max_ns();
+        ScannerSnapshot before = scanner_snapshot();
+        if (has_scanner) set_scan_interval_ms(interval_ms);
+        LatencySummary app_scan = probe_app_latency(window_ms, timer_overhead);
+        if (has_scanner) set_scan_interval_ms(0);
+        ScannerSnapshot after = scanner_snapshot();
+
+        uint64_t scans = after.scans - before.scans;
+        double scan_avg_ns = scans ? (double)(after.total_ns - before.total_ns) / scans : 0;
+        // Not every live block is tracked: the walk and untrack stop growing
+        saturated = has_scanner && (after.tracked < level || (capacity && after.tracked >= capacity));
+
+        printf("%10lu %9lu %9lu %9lu %9lu %11.1f %11.1f %9lu %9lu%s\n",
+               level, after.tracked, free_lat.p50_ns, free_lat.p99_ns, scans,
+               scan_avg_ns / 1000.0, after.max_ns / 1000.0, app_idle.p99_ns, app_scan.p99_ns,
+               saturated ? "  SATURATED" : "");
+
+        if (!first) json += ",\n";
+        first = false;
+        char buf[512];
+        snprintf(buf, sizeof(buf),
+                 "    {\"live\": %lu, \"tracked\": %lu, \"saturated\": %s, \"populate_ns_per_alloc\": %.1f, "
+                 "\"scans\": %lu, \"scan_avg_ns\": %.0f, \"scan_max_ns\": %lu,\n     \"free\": {",
+                 level, after.tracked, saturated ? "true" : "false", populate_ns, scans, scan_avg_ns,
+                 after.max_ns);
+        json += buf;
+        append_latency_json(json, free_lat);
+        json += "},\n     \"app_scanner_paused\": {";
+        append_latency_json(json, app_idle);
+        json += "},\n     \"app_scanner_active\": {";
+        append_latency_json(json, app_scan);
+        json += "}}";
+    }
+    json += "\n  ]\n}\n";
+
+    printf("\napp_p99 = scanner paused, app_p99* = scanner ticking every %lu ms (ns)\n", interval_ms);
+    if (saturated) {
+        printf("⚠️  SATURATED: the agent tracked only %lu of the live allocations, so that level's scan and "
+               "free() numbers don't scale with it; later levels were skipped\n",
+               scanner_snapshot().tracked);
+    }
+    if (!has_scanner) printf("No advanced agent loaded: scanner columns are empty\n");
+
+    if (json_path) {
+        if (!write_text_file(json_path, json)) return 1;
+        printf("JSON results written to %s\n", json_path);
+    }
+    return 0;
+}
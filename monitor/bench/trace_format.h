@@ -0,0 +1,102 @@
+#pragma once
+
+// Allocation trace format shared by trace_replay and alloc_sim.
+//
+// CSV, '#' starts a comment, header line optional:
+//     relative_ns,thread,op,object_id,size
+// op is one of malloc, calloc, realloc, free. object_id names one block
+// lifetime: realloc/free refer to the id a previous malloc/calloc
+// created, possibly on another thread; load_trace() rejects traces
+// that use an id that isn't live at that point in file order.
+// bench/trace_record.py writes this format from the advanced agent's
+// ring.
+
+#include <stdio.h>
+#include <string.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+enum TraceOp : uint8_t { TOP_MALLOC, TOP_CALLOC, TOP_REALLOC, TOP_FREE, NUM_TRACE_OPS };
+static const char* TRACE_OP_NAMES[NUM_TRACE_OPS] = {"malloc", "calloc", "realloc", "free"};
+
+struct TraceRecord {
+    uint64_t t_ns;
+    uint32_t thread;  // dense thread index
+    uint32_t slot;    // dense index of object_id
+    uint32_t seq;     // position among the ops on this slot, in file order
+    uint64_t size;
+    TraceOp op;
+};
+
+struct Trace {
+    std::vector<TraceRecord> records;  // file order
+    size_t num_threads = 0;
+    size_t num_objects = 0;
+};
+
+static inline bool parse_trace_op(const char* s, TraceOp* op) {
+    for (int i = 0; i < NUM_TRACE_OPS; i++) {
+        if (strcmp(s, TRACE_OP_NAMES[i]) == 0) {
+            *op = (TraceOp)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Thread and object ids are remapped to dense indices
+static inline bool load_trace(const char* path, Trace* trace) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    std::unordered_map<uint64_t, uint32_t> thread_index;
+    std::unordered_map<uint64_t, uint32_t> object_slot;
+    std::vector<uint32_t> slot_ops;   // ops seen per slot
+    std::vector<bool> slot_live;
+    char line[256];
+    size_t lineno = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        if (line[0] == '#' || line[0] == '\n' || strncmp(line, "relative_ns", 11) == 0) continue;
+
+        unsigned long long t, tid, id, size;
+        char opname[16];
+        TraceOp op;
+        if (sscanf(line, "%llu,%llu,%15[^,],%llu,%llu", &t, &tid, opname, &id, &size) != 5 ||
+            !parse_trace_op(opname, &op)) {
+            fprintf(stderr, "%s:%zu: malformed trace line\n", path, lineno);
+            fclose(f);
+            return false;
+        }
+
+        uint32_t thread = thread_index.emplace(tid, (uint32_t)thread_index.size()).first->second;
+        uint32_t slot = object_slot.emplace(id, (uint32_t)object_slot.size()).first->second;
+        if (slot == slot_ops.size()) {
+            slot_ops.push_back(0);
+            slot_live.push_back(false);
+        }
+
+        // Replay waits for the previous op on the object, so an op on a
+        // dead or unknown id would never become runnable
+        bool allocates = op == TOP_MALLOC || op == TOP_CALLOC;
+        if (allocates == slot_live[slot]) {
+            fprintf(stderr, "%s:%zu: %s of %s object %llu\n", path, lineno, opname,
+                    allocates ? "live" : "unallocated", id);
+            fclose(f);
+            return false;
+        }
+        slot_live[slot] = op != TOP_FREE;
+
+        trace->records.push_back({t, thread, slot, slot_ops[slot]++, size, op});
+    }
+    fclose(f);
+
+    trace->num_threads = thread_index.size();
+    trace->num_objects = object_slot.size();
+    return true;
+}
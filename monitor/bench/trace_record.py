@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""
+Record an allocation trace from the advanced agent's ring
+=========================================================
+
+Drains /dev/shm/ml_advanced_leak_detection with the advanced analyzer's
+read path and writes the CSV format trace_replay consumes:
+
+    relative_ns,thread,op,object_id,size
+
+Addresses are turned into unique object ids (a reused address starts a
+new object) and frees of blocks allocated before recording started are
+skipped. The ring only holds LEAK_BUFFER_SIZE events, so at high
+allocation rates events can be lost; the number of lost events (gaps
+in event_id) is reported at the end.
+
+Usage: trace_record.py --out trace.csv [--duration SECONDS]
+"""
+
+import argparse
+import os
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from advanced_analyzer import AdvancedLeakAnalyzer  # noqa: E402
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Record an allocation trace from the advanced agent')
+    parser.add_argument('--out', required=True, help='CSV trace file to write')
+    parser.add_argument('--duration', type=float, default=0, help='stop after N seconds (0 = until Ctrl+C)')
+    args = parser.parse_args()
+
+    analyzer = AdvancedLeakAnalyzer()
+    if not analyzer.connect_to_shared_memory():
+        return 1
+
+    live = {}           # address -> object id
+    threads = {}        # agent thread id -> dense index
+    next_object = 0
+    first_ts = None
+    last_event_id = None
+    recorded = lost = skipped = 0
+    pos = analyzer.read_buffer_header()[0]
+    deadline = time.time() + args.duration if args.duration else None
+
+    with open(args.out, 'w') as out:
+        out.write('relative_ns,thread,op,object_id,size\n')
+        try:
+            while deadline is None or time.time() < deadline:
+                write_index = analyzer.read_buffer_header()[0]
+                if write_index - pos > 1000:  # LEAK_BUFFER_SIZE
+                    # Overwritten; the event_id gap below counts them
+                    pos = write_index - 1000
+
+                while pos < write_index:
+                    event = analyzer.read_leak_event(pos % 1000)
+                    pos += 1
+                    if not event:
+                        continue
+
+                    # Every event type takes an id, so only gaps are losses
+                    if last_event_id is not None and event.event_id > last_event_id + 1:
+                        lost += event.event_id - last_event_id - 1
+                    last_event_id = event.event_id
+                    if event.event_type not in (analyzer.EVENT_MALLOC, analyzer.EVENT_FREE):
+                        continue
+
+                    if first_ts is None:
+                        first_ts = event.timestamp
+                    thread = threads.setdefault(event.thread_id, len(threads))
+                    address = event.data['address']
+
+                    if event.event_type == analyzer.EVENT_MALLOC:
+                        live[address] = next_object
+                        op, obj = 'malloc', next_object
+                        next_object += 1
+                    else:
+                        if address not in live:
+                            skipped += 1
+                            continue
+                        op, obj = 'free', live.pop(address)
+
+                    out.write(f"{event.timestamp - first_ts},{thread},{op},{obj},{event.data['size']}\n")
+                    recorded += 1
+
+                time.sleep(0.001)
+        except KeyboardInterrupt:
+            pass
+
+    analyzer.cleanup()
+    print(f"Recorded {recorded} ops on {len(threads)} threads to {args.out} "
+          f"({lost} events lost, {skipped} frees of pre-existing blocks skipped)")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,175 @@
+// Allocation trace replayer
+// =========================
+//
+// Reissues a recorded malloc/calloc/realloc/free sequence on the
+// recorded number of threads, either as fast as possible or paced to the
+// recorded timestamps. Run it plain and under each agent to compare
+// overhead, contention and RSS on exactly the recorded pattern.
+//
+// Trace format: see trace_format.h. Each op waits until every earlier
+// op on the same object (in file order) has completed, so frees and
+// reallocs of blocks owned by another thread follow the owner.
+//
+// Usage: trace_replay --trace FILE [--mode full|realtime] [--json FILE]
+
+#include <sys/resource.h>
+#include <atomic>
+#include <thread>
+#include "bench_util.h"
+#include "trace_format.h"
+
+struct ThreadTrace {
+    std::vector<TraceRecord> records;
+    std::vector<uint64_t> latency[NUM_TRACE_OPS];
+    uint64_t waits = 0;  // ops that had to wait for another thread's op on the object
+};
+
+// Splits the trace into per-thread streams, keeping per-thread order
+static void split_by_thread(const Trace& trace, std::vector<ThreadTrace>& threads) {
+    threads.resize(trace.num_threads);
+    for (const TraceRecord& r : trace.records) {
+        threads[r.thread].records.push_back(r);
+    }
+}
+
+// Slots are shared so frees/reallocs can follow blocks across threads.
+// seq counts completed ops on the slot; ptr is published before it.
+struct Slot {
+    std::atomic<void*> ptr{nullptr};
+    std::atomic<uint32_t> seq{0};
+};
+static Slot* slots = nullptr;
+
+static void replay_thread(ThreadTrace* tt, bool realtime, uint64_t start_ns, uint64_t timer_overhead) {
+    for (auto& v : tt->latency) v.reserve(tt->records.size());
+
+    for (const TraceRecord& r : tt->records) {
+        if (realtime) {
+            uint64_t due = start_ns + r.t_ns;
+            uint64_t now = bench_now_ns();
+            if (due > now + 50000) {
+                struct timespec ts = {(time_t)((due - now) / 1000000000ULL), (long)((due - now) % 1000000000ULL)};
+                nanosleep(&ts, nullptr);
+            }
+            while (bench_now_ns() < due) {
+            }
+        }
+
+        // Another thread may still have earlier ops on this object pending
+        Slot& slot = slots[r.slot];
+        bool waited = false;
+        while (slot.seq.load(std::memory_order_acquire) != r.seq) {
+            waited = true;
+            std::this_thread::yield();
+        }
+        if (waited) tt->waits++;
+        void* old = slot.ptr.load(std::memory_order_relaxed);
+
+        void* result = nullptr;
+        uint64_t t0 = bench_now_ns();
+        switch (r.op) {
+        case TOP_MALLOC:
+            result = malloc(r.size);
+            break;
+        case TOP_CALLOC:
+            result = calloc(1, r.size);
+            break;
+        case TOP_REALLOC:
+            result = realloc(old, r.size);
+            break;
+        case TOP_FREE:
+            free(old);
+            break;
+        default:
+            break;
+        }
+        uint64_t dt = bench_now_ns() - t0;
+        tt->latency[r.op].push_back(dt > timer_overhead ? dt - timer_overhead : 0);
+
+        // Touch the first byte like an application would
+        if (result && r.op != TOP_CALLOC) *(volatile char*)result = 1;
+        slot.ptr.store(result, std::memory_order_relaxed);
+        slot.seq.store(r.seq + 1, std::memory_order_release);
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* trace_path = bench_arg(argc, argv, "--trace", nullptr);
+    std::string mode = bench_arg(argc, argv, "--mode", "full");
+    const char* json_path = bench_arg(argc, argv, "--json", nullptr);
+
+    if (!trace_path || (mode != "full" && mode != "realtime")) {
+        fprintf(stderr, "Usage: %s --trace FILE [--mode full|realtime] [--json FILE]\n", argv[0]);
+        return 1;
+    }
+
+    Trace trace;
+    if (!load_trace(trace_path, &trace)) return 1;
+    size_t num_slots = trace.num_objects, num_ops = trace.records.size();
+    if (num_ops == 0) {
+        fprintf(stderr, "%s: empty trace\n", trace_path);
+        return 1;
+    }
+
+    std::vector<ThreadTrace> threads;
+    split_by_thread(trace, threads);
+    trace.records.clear();
+    trace.records.shrink_to_fit();
+
+    slots = new Slot[num_slots];
+    uint64_t timer_overhead = calibrate_timer_overhead_ns();
+
+    printf("=== TRACE REPLAY (%s, %s mode) ===\n", detect_agent_name(), mode.c_str());
+    printf("trace: %zu ops, %zu threads, %zu objects\n\n", num_ops, threads.size(), num_slots);
+
+    // Common start for realtime pacing; full mode runs (and is timed) from now
+    uint64_t start = bench_now_ns() + (mode == "realtime" ? 1000000 : 0);
+    std::vector<std::thread> workers;
+    for (auto& tt : threads) {
+        workers.emplace_back(replay_thread, &tt, mode == "realtime", start, timer_overhead);
+    }
+    for (auto& w : workers) w.join();
+    uint64_t elapsed = bench_now_ns() - start;
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+
+    uint64_t waits = 0;
+    std::string json = "{\n  \"benchmark\": \"trace_replay\",\n";
+    json += "  \"agent\": \"" + std::string(detect_agent_name()) + "\",\n";
+    json += "  \"trace\": \"" + std::string(trace_path) + "\",\n";
+    json += "  \"mode\": \"" + mode + "\",\n";
+
+    printf("%-8s %10s %9s %8s %8s %8s\n", "op", "count", "mean_ns", "p50", "p99", "p999");
+    std::string ops_json;
+    for (int op = 0; op < NUM_TRACE_OPS; op++) {
+        std::vector<uint64_t> merged;
+        for (auto& tt : threads) merged.insert(merged.end(), tt.latency[op].begin(), tt.latency[op].end());
+        if (merged.empty()) continue;
+        LatencySummary s = summarize_latency(merged);
+        printf("%-8s %10lu %9.1f %8lu %8lu %8lu\n", TRACE_OP_NAMES[op], s.count, s.mean_ns, s.p50_ns,
+               s.p99_ns, s.p999_ns);
+        if (!ops_json.empty()) ops_json += ",\n";
+        ops_json += "    {\"op\": \"" + std::string(TRACE_OP_NAMES[op]) + "\", ";
+        append_latency_json(ops_json, s);
+        ops_json += "}";
+    }
+    for (auto& tt : threads) waits += tt.waits;
+
+    printf("\nwall time: %.3f s (%.0f ops/s), cross-thread waits: %lu, peak RSS: %ld KB\n",
+           elapsed / 1e9, num_ops / (elapsed / 1e9), waits, ru.ru_maxrss);
+
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "  \"ops_total\": %zu, \"threads\": %zu, \"objects\": %zu, \"wall_ns\": %lu, "
+             "\"ops_per_sec\": %.0f, \"cross_thread_waits\": %lu, \"peak_rss_kb\": %ld,\n",
+             num_ops, threads.size(), num_slots, elapsed, num_ops / (elapsed / 1e9), waits, ru.ru_maxrss);
+    json += buf;
+    json += "  \"ops\": [\n" + ops_json + "\n  ]\n}\n";
+
+    if (json_path) {
+        if (!write_text_file(json_path, json)) return 1;
+        printf("JSON results written to %s\n", json_path);
+    }
+    return 0;
+}
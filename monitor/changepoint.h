@@ -0,0 +1,172 @@
+#pragma once
+
+// Leak onset timing (see ChangePointTable in shm_layout.h).
+//
+// The trend detector says whether a site is growing; this says when the
+// growth (or the allocation rate) changed, so an alert can be matched to
+// a deploy or a traffic shift. Each series is a fixed-size two-sided
+// CUSUM fed once per tick by the scanner thread, from counters the hooks
+// already maintain. Alerts are printed as [CHANGE] and kept in a ring.
+// Reader: agent_stats.py --changes.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <cstdint>
+#include "shm_layout.h"
+#include "percpu_counters.h"
+#include "site_sketch.h"
+#include "site_trend.h"
+
+#define CHANGEPOINT_DEFAULT_TICK_NS 1000000000ULL
+#define CHANGEPOINT_ALPHA 0.05
+#define CHANGEPOINT_K 0.5
+#define CHANGEPOINT_DEFAULT_H 6.0
+#define CHANGEPOINT_CLIP 3.0       // one odd tick can't raise an alarm on its own
+#define CHANGEPOINT_REL_FLOOR 0.05 // stddev floor relative to the baseline, against too-quiet series
+
+static ChangePointTable* change_points = nullptr;
+
+static const char* const changepoint_series_names[CP_SERIES] = {"live bytes growth", "allocation rate"};
+
+static void changepoint_restart(CusumState& state) {
+    state.samples = 0;
+    state.pos = state.neg = 0;
+    state.pos_sum = state.neg_sum = 0;
+    state.pos_ticks = state.neg_ticks = 0;
+}
+
+static void changepoint_alert(ChangePointTable* table, CusumState& state, uint32_t series, uint32_t site_id,
+                              int direction, uint64_t now_ns) {
+    double after = direction > 0 ? state.pos_sum / state.pos_ticks : state.neg_sum / state.neg_ticks;
+    ChangeAlert& alert = table->alerts[table->alerts_written % CHANGEPOINT_ALERTS];
+    alert.series = series;
+    alert.site_id = site_id;
+    alert.direction = direction;
+    alert.onset_ns = direction > 0 ? state.pos_start_ns : state.neg_start_ns;
+    alert.alarm_ns = now_ns;
+    alert.before = state.mean;
+    alert.after = after;
+    table->alerts_written++;
+    state.alarms++;
+    state.last_alarm_ns = now_ns;
+
+    char where[32];
+    if (site_id == CP_PROCESS_SITE) snprintf(where, sizeof(where), "process");
+    else snprintf(where, sizeof(where), "site %u", site_id);
+    printf("[CHANGE] 🔥 %s %s %s: %.0f/s -> %.0f/s, onset %.1fs ago\n", where, changepoint_series_names[series],
+           direction > 0 ? "up" : "down", state.mean, after, (now_ns - alert.onset_ns) / 1e9);
+    changepoint_restart(state);
+}
+
+// One tick of one series: raw is the counter now, prev_ns the last tick
+static void changepoint_update(ChangePointTable* table, CusumState& state, uint32_t series, uint32_t site_id,
+                               int64_t raw, uint64_t prev_ns, uint64_t now_ns) {
+    int64_t last = state.last_raw;
+    state.last_raw = raw;
+    if (!prev_ns) return;  // first tick: no rate yet
+    double x = (double)(raw - last) / ((now_ns - prev_ns) / 1e9);
+
+    if (state.samples < table->warmup_ticks) {
+        // (Re)learning the baseline: plain running mean and variance
+        if (state.samples++ == 0) state.mean = state.variance = 0;
+        double deviation = x - state.mean;
+        state.mean += deviation / state.samples;
+        state.variance += (deviation * (x - state.mean) - state.variance) / state.samples;
+        state.pos_start_ns = state.neg_start_ns = now_ns;
+        return;
+    }
+
+    double stddev = fmax(sqrt(state.variance), fmax(1.0, CHANGEPOINT_REL_FLOOR * fabs(state.mean)));
+    double z = fmin(fmax((x - state.mean) / stddev, -CHANGEPOINT_CLIP), CHANGEPOINT_CLIP);
+    if (state.pos == 0) state.pos_start_ns = prev_ns;
+    if (state.neg == 0) state.neg_start_ns = prev_ns;
+    state.pos = fmax(0, state.pos + z - table->k);
+    state.neg = fmax(0, state.neg - z - table->k);
+    if (state.pos > 0) {
+        state.pos_sum += x;
+        state.pos_ticks++;
+    } else {
+        state.pos_sum = 0;
+        state.pos_ticks = 0;
+    }
+    if (state.neg > 0) {
+        state.neg_sum += x;
+        state.neg_ticks++;
+    } else {
+        state.neg_sum = 0;
+        state.neg_ticks = 0;
+    }
+
+    if (state.pos > table->h) {
+        changepoint_alert(table, state, series, site_id, +1, now_ns);
+    } else if (state.neg > table->h) {
+        changepoint_alert(table, state, series, site_id, -1, now_ns);
+    } else if (state.pos == 0 && state.neg == 0) {
+        double deviation = x - state.mean;
+        state.mean += table->alpha * deviation;
+        state.variance = (1 - table->alpha) * (state.variance + table->alpha * deviation * deviation);
+    }
+}
+
+// Scanner thread, after site_age_advance: feed every series once tick_ns has passed
+static void changepoint_tick(uint64_t now_ns) {
+    ChangePointTable* table = change_points;
+    SiteAgeTable* ages = site_age_table;
+    SiteTable* sites = site_table;
+    if (!table || !ages || !sites) return;
+    if (now_ns - table->last_tick_ns < table->tick_ns) return;
+    uint64_t prev_ns = table->last_tick_ns;
+    table->last_tick_ns = now_ns;
+
+    uint64_t sums[NUM_CPU_COUNTERS];
+    percpu_sum_all(sums);
+    // The process series start at the first tick too: startup is no baseline
+    uint64_t process_prev = table->process[CP_ALLOC_RATE].last_raw ? prev_ns : 0;
+    uint64_t seq = table->seq;
+    __atomic_store_n(&table->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    changepoint_update(table, table->process[CP_LIVE_BYTES], CP_LIVE_BYTES, CP_PROCESS_SITE,
+                       (int64_t)sums[CTR_CURRENT_BYTES], process_prev, now_ns);
+    changepoint_update(table, table->process[CP_ALLOC_RATE], CP_ALLOC_RATE, CP_PROCESS_SITE,
+                       (int64_t)sums[CTR_ALLOCATIONS], process_prev, now_ns);
+    for (int i = 0; i < SITE_TABLE_SIZE; i++) {
+        SiteSketches& site = sites->sites[i];
+        if (!__atomic_load_n(&site.key, __ATOMIC_ACQUIRE)) continue;
+        const char* base = (const char*)&site.size;
+        int64_t allocs = (int64_t)__atomic_load_n((const uint64_t*)(base + offsetof(QuantileSketch, count)),
+                                                  __ATOMIC_RELAXED);
+        // A site claimed since the last tick starts its series now and
+        // learns its own baseline over warmup_ticks, like the process did:
+        // a cache filled lazily or a second model load ramps up from zero
+        // without being a change. Sites that grow from birth and never
+        // level off are the trend detector's (site_trend.h).
+        uint64_t site_prev = table->sites[i][CP_ALLOC_RATE].last_raw ? prev_ns : 0;
+        changepoint_update(table, table->sites[i][CP_LIVE_BYTES], CP_LIVE_BYTES, site.site_id,
+                           site_live_bytes(ages->sites[i]), site_prev, now_ns);
+        changepoint_update(table, table->sites[i][CP_ALLOC_RATE], CP_ALLOC_RATE, site.site_id, allocs, site_prev,
+                           now_ns);
+    }
+    __atomic_store_n(&table->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// area: zeroed ChangePointTable in shm
+static inline void changepoint_init(ChangePointTable* area, uint64_t now_ns) {
+    area->num_sites = SITE_TABLE_SIZE;
+    area->tick_ns = CHANGEPOINT_DEFAULT_TICK_NS;
+    area->alpha = CHANGEPOINT_ALPHA;
+    area->k = CHANGEPOINT_K;
+    area->h = CHANGEPOINT_DEFAULT_H;
+    if (const char* env = getenv("CHANGEPOINT_TICK_MS")) {
+        uint64_t ms = strtoull(env, nullptr, 10);
+        if (ms) area->tick_ns = ms * 1000000ULL;
+    }
+    if (const char* env = getenv("CHANGEPOINT_H")) {
+        double h = atof(env);
+        if (h > 0) area->h = h;
+    }
+    area->warmup_ticks = (uint32_t)ceil(1 / area->alpha);
+    area->last_tick_ns = now_ns;
+    __atomic_store_n(&area->magic, CHANGEPOINT_MAGIC, __ATOMIC_RELEASE);
+    change_points = area;
+}
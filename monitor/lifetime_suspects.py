@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+"""
+Lifetime-profile leak suspects
+==============================
+
+Flags sites whose allocations outlive the site's own lifetime history,
+without scanning allocations: only the per-site sketches the advanced
+agent updates on every malloc/free (agent_stats.py --sites) are read.
+
+For a site with p99 lifetime L, every allocation made before now - L
+should be gone by now. Frees can't be told apart by age, but
+all frees so far include every free of an old allocation, so
+
+    overdue(now) >= allocs(now - L) - frees(now)
+
+is a lower bound on the allocations older than the site's profile. It
+stays flat (usually negative) for healthy churn, including churn that
+slows down or stops, and grows by one per leaked allocation once L has
+passed, even when the leaks share the site with normal traffic. A site
+is a suspect when the bound is positive and has grown over the last
+--window seconds. Sites with fewer than --min-frees frees have no
+usable profile; for them L is --min-age.
+
+allocs(now - L) comes from this reader's own history of the counters,
+so a site can only be judged L seconds after the reader started.
+
+Usage: lifetime_suspects.py [--interval S] [--window S] [--min-age S]
+                            [--min-frees N] [--min-overdue N] [--once-after S] [--json]
+"""
+
+import argparse
+import bisect
+import json
+import mmap
+import os
+import sys
+import time
+from collections import deque
+
+from agent_stats import SEGMENTS, check_segment, format_us, read_site_sketches, sketch_quantile
+
+
+class LifetimeSuspectDetector:
+    def __init__(self, window=5.0, min_age=10.0, min_frees=20, min_overdue=3, max_history=3600.0):
+        self.window = window
+        self.min_age = min_age
+        self.min_frees = min_frees
+        self.min_overdue = min_overdue
+        self.max_history = max_history
+        self.history = {}   # site_id -> deque of (t, allocs, frees)
+        self.overdue = {}   # site_id -> deque of (t, overdue bound)
+
+    def allocs_at(self, history, t):
+        """Cumulative allocations at time t, interpolated between polls; None if before history"""
+        times = [sample[0] for sample in history]
+        i = bisect.bisect_right(times, t) - 1
+        if i < 0:
+            return None
+        t0, allocs0, _ = history[i]
+        if i + 1 == len(history) or t <= t0:
+            return allocs0
+        # Lifetimes are often much shorter than the poll period
+        t1, allocs1, _ = history[i + 1]
+        return allocs0 + (allocs1 - allocs0) * (t - t0) / (t1 - t0)
+
+    def update(self, now, sub_bits, sites):
+        """Feeds one poll of the site table; returns the current suspects"""
+        suspects = []
+        for site in sites:
+            sid = site['site_id']
+            allocs, frees = site['size']['count'], site['lifetime_us']['count']
+            history = self.history.setdefault(sid, deque())
+            history.append((now, allocs, frees))
+            while history and now - history[0][0] > self.max_history:
+                history.popleft()
+
+            profiled = frees >= self.min_frees
+            lifetime = sketch_quantile(site['lifetime_us'], 0.99, sub_bits) / 1e6 if profiled else self.min_age
+            old_allocs = self.allocs_at(history, now - lifetime)
+            if old_allocs is None:
+                continue  # not watched for long enough to judge this site
+            bound = int(old_allocs - frees)
+
+            series = self.overdue.setdefault(sid, deque())
+            series.append((now, bound))
+            while series and now - series[0][0] > self.window:
+                series.popleft()
+            growth = bound - series[0][1]
+            span = now - series[0][0]
+            if bound >= self.min_overdue and growth > 0 and span >= self.window * 0.8:
+                size = site['size']
+                mean_size = size['sum'] / size['count'] if size['count'] else 0
+                suspects.append({
+                    'site_id': sid,
+                    'module': site['module'],
+                    'module_offset': site['module_offset'],
+                    'live': allocs - frees,
+                    'overdue': bound,
+                    'overdue_bytes_est': int(bound * mean_size),
+                    'growth_per_sec': round(growth / span, 2),
+                    'lifetime_p99_s': round(lifetime, 4),
+                    'profiled': profiled,
+                })
+        suspects.sort(key=lambda s: s['overdue_bytes_est'], reverse=True)
+        return suspects
+
+
+def print_suspects(suspects):
+    if not suspects:
+        print("✅ No site outlives its lifetime profile")
+        return
+    print(f"🔥 {len(suspects)} sites with allocations older than their lifetime profile")
+    print(f"{'site_id':>8} {'module+offset':<28} {'live':>8} {'overdue':>8} {'~bytes':>11} "
+          f"{'growth/s':>9} {'life p99':>10}")
+    for s in suspects:
+        where = f"{s['module']}+{s['module_offset']:#x}" if s['module'] else '?'
+        life = format_us(s['lifetime_p99_s'] * 1e6) if s['profiled'] else 'no frees'
+        print(f"{s['site_id']:>8} {where[:28]:<28} {s['live']:>8} {s['overdue']:>8} "
+              f"{s['overdue_bytes_est']:>11} {s['growth_per_sec']:>9} {life:>10}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Leak suspects from per-site lifetime profiles')
+    parser.add_argument('--interval', type=float, default=1.0, help='poll period in seconds')
+    parser.add_argument('--window', type=float, default=5.0, help='growth window in seconds')
+    parser.add_argument('--min-age', type=float, default=10.0, help='lifetime assumed for sites without frees')
+    parser.add_argument('--min-frees', type=int, default=20, help='frees needed to trust a site profile')
+    parser.add_argument('--min-overdue', type=int, default=3, help='overdue allocations needed to report')
+    parser.add_argument('--once-after', type=float, default=0,
+                        help='poll for this many seconds, print once and exit')
+    parser.add_argument('--json', action='store_true', help='print JSON instead of a table')
+    args = parser.parse_args()
+
+    path = SEGMENTS['advanced'][0]
+    try:
+        fd = os.open(path, os.O_RDONLY)
+    except FileNotFoundError:
+        print(f"❌ {path} not found: is a process running with the advanced agent?")
+        return 1
+    error = check_segment(fd, 'advanced')
+    if error:
+        print(f"❌ {error}")
+        return 1
+    shm = mmap.mmap(fd, 0, access=mmap.ACCESS_READ)
+    detector = LifetimeSuspectDetector(args.window, args.min_age, args.min_frees, args.min_overdue)
+    start = time.monotonic()
+
+    try:
+        while True:
+            table = read_site_sketches(shm)
+            if not table:
+                print("❌ Site sketches missing (older agent build?)")
+                return 1
+            sub_bits, _, sites = table
+            now = time.monotonic()
+            suspects = detector.update(now, sub_bits, sites)
+            if not args.once_after or now - start >= args.once_after:
+                if args.json:
+                    print(json.dumps({'t': round(now - start, 3), 'suspects': suspects}))
+                else:
+                    print_suspects(suspects)
+                if args.once_after:
+                    break
+            time.sleep(args.interval)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        shm.close()
+        os.close(fd)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""
+Tree model code generator
+=========================
+
+Compiles an exported model (model_export.py -> ml_model.bin) into a C++
+header of constexpr tables and a branch-free scoring function. The
+header can be built into the agent or a collector next to the
+interpreted engine (anomaly_model.h); model_score --engine picks either
+and --bench compares them.
+
+Every tree is padded to a complete binary tree of the forest's maximum
+depth. A leaf above that depth becomes splits that always go left
+(threshold +inf) and whose subtrees all carry the leaf's value. The
+walk is then the same fixed number of steps for every tree:
+
+    i = 2 * i + 1 + !(x[feature[i]] <= threshold[i])
+
+The steps compile to compares and setcc rather than data-dependent
+jumps, and the loops unroll because the depth is a constant. Padding
+doubles the table size per level, so deeper models (--max-depth) are
+left to the interpreted engine.
+
+Usage: model_codegen.py [--model ml_model.bin] [--out ml_model_gen.h] [--max-depth N]
+"""
+
+import argparse
+import math
+import sys
+
+from model_export import MODEL_LEAF, parse_exported
+
+
+def tree_depth(nodes, root):
+    depth, stack = 0, [(root, 0)]
+    while stack:
+        i, d = stack.pop()
+        if nodes[i][1] == MODEL_LEAF:
+            depth = max(depth, d)
+        else:
+            stack.append((i + 1, d + 1))
+            stack.append((nodes[i][2], d + 1))
+    return depth
+
+
+def complete_tree(model, root, depth):
+    """(features, thresholds, leaves) of one tree as a complete tree in heap order"""
+    nodes, values = model['nodes'], model['values']
+    n_classes, positive = model['n_classes'], model['positive_class']
+    internal = (1 << depth) - 1
+    features = [0] * internal
+    thresholds = [math.inf] * internal
+    leaves = [0.0] * (1 << depth)
+
+    # (heap slot, node or None once below a leaf, leaf value carried down)
+    stack = [(0, root, None)]
+    while stack:
+        slot, i, carried = stack.pop()
+        if slot >= internal:
+            leaves[slot - internal] = carried if i is None else values[nodes[i][2] * n_classes + positive]
+            continue
+        if i is not None and nodes[i][1] != MODEL_LEAF:
+            threshold, feature, right = nodes[i]
+            features[slot], thresholds[slot] = feature, threshold
+            stack.append((2 * slot + 1, i + 1, None))
+            stack.append((2 * slot + 2, right, None))
+            continue
+        # Leaf above the full depth: always left, same value everywhere below
+        if i is not None:
+            carried = values[nodes[i][2] * n_classes + positive]
+        stack.append((2 * slot + 1, None, carried))
+        stack.append((2 * slot + 2, None, carried))
+    return features, thresholds, leaves
+
+
+def c_double(v):
+    return 'INFINITY' if v == math.inf else repr(float(v))
+
+
+def c_float(v):
+    # float.hex is exact: the table holds the same float32 the file does
+    return f"{float(v).hex()}f"
+
+
+def generate(model, source_path):
+    roots = model['roots']
+    # At least one level, so the tables are never empty
+    depth = max(1, max(tree_depth(model['nodes'], root) for root in roots))
+    trees = [complete_tree(model, root, depth) for root in roots]
+    feature_type = 'uint8_t' if model['n_features'] <= 256 else 'uint16_t'
+    internal = (1 << depth) - 1
+
+    def table(rows, fmt):
+        return ',\n'.join('    {' + ', '.join(fmt(v) for v in row) + '}' for row in rows)
+
+    return f"""#pragma once
+
+// Generated by model_codegen.py from {source_path}: do not edit.
+// Source model: {model['source']} (format {model['version'][0]}.{model['version'][1]}, payload hash
+// {model['payload_hash']:#018x}). Compiled equivalent of anomaly_model_score() for that file.
+
+#include <math.h>
+#include <cstdint>
+
+namespace ml_model_gen {{
+
+inline constexpr uint32_t kFeatures = {model['n_features']};
+inline constexpr uint32_t kTrees = {len(roots)};
+inline constexpr uint32_t kDepth = {depth};
+inline constexpr uint32_t kInternal = {internal};
+inline constexpr uint64_t kPayloadHash = {model['payload_hash']:#018x}ULL;
+inline constexpr const char* kSource = "{model['source']}";
+
+alignas(64) inline constexpr {feature_type} kFeature[kTrees][kInternal] = {{
+{table((t[0] for t in trees), str)}
+}};
+
+alignas(64) inline constexpr double kThreshold[kTrees][kInternal] = {{
+{table((t[1] for t in trees), c_double)}
+}};
+
+alignas(64) inline constexpr float kLeaf[kTrees][1u << kDepth] = {{
+{table((t[2] for t in trees), c_float)}
+}};
+
+// Probability of the positive class for raw features x[kFeatures]
+inline double score(const double* x) {{
+    double sum = 0;
+    for (uint32_t t = 0; t < kTrees; t++) {{
+        uint32_t i = 0;
+        for (uint32_t d = 0; d < kDepth; d++) {{
+            i = 2 * i + 1 + !(x[kFeature[t][i]] <= kThreshold[t][i]);
+        }}
+        sum += kLeaf[t][i - kInternal];
+    }}
+    return sum / kTrees;
+}}
+
+}}  // namespace ml_model_gen
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compile an exported tree model into a C++ header')
+    parser.add_argument('--model', default='ml_model.bin', help='exported model (model_export.py)')
+    parser.add_argument('--out', default='ml_model_gen.h', help='header to write')
+    parser.add_argument('--max-depth', type=int, default=10, help='deepest tree worth padding')
+    args = parser.parse_args()
+
+    try:
+        with open(args.model, 'rb') as f:
+            model = parse_exported(f.read())
+    except (OSError, ValueError) as e:
+        print(f"❌ {args.model}: {e}")
+        return 1
+    depth = max(tree_depth(model['nodes'], root) for root in model['roots'])
+    if depth > args.max_depth:
+        print(f"❌ trees {depth} deep (> --max-depth {args.max_depth}): use the interpreted engine")
+        return 1
+    with open(args.out, 'w') as f:
+        f.write(generate(model, args.model))
+    print(f"🛠️  {args.out}: {len(model['roots'])} trees padded to depth {depth}")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,293 @@
+#!/usr/bin/env python3
+"""
+Anomaly model exporter
+======================
+
+Turns the pickled scikit-learn model (ml_model.pkl: a dict with a
+RandomForestClassifier or DecisionTreeClassifier under 'classifier' and
+an optional StandardScaler under 'scaler') into the versioned binary
+format of model_format.h, which the native engine (anomaly_model.h,
+model_score) loads without Python.
+
+Neither scikit-learn nor numpy is needed. The pickle is decoded with an
+unpickler that only accepts the classes a fitted tree model is made of,
+and turns them into plain records. That is also safer than pickle.load
+on a file of unknown origin.
+
+The scaler is folded into the split thresholds: (x - mean) / scale <= t
+becomes x <= t * scale + mean. The native engine then compares raw
+features, and its scores match predict_proba except for features lying
+exactly on a split threshold. --check N scores N random vectors both
+ways (this file's reference walk of the pickled trees with the scaler
+applied, and the exported file) and reports the largest difference.
+
+Usage: model_export.py [--model ml_model.pkl] [--out ml_model.bin] [--check N]
+"""
+
+import argparse
+import pickle
+import random
+import struct
+import sys
+
+HEADER = struct.Struct('<IHHIIIIIIIIQQ64s8x')
+NODE = struct.Struct('<diI')
+MODEL_MAGIC = 0x4c444d41
+MODEL_VERSION = (1, 0)
+MODEL_LEAF = -1
+MODEL_FOLDED_SCALER = 0x1
+
+# numpy type codes -> struct codes
+NUMPY_TYPES = {'i1': 'b', 'u1': 'B', 'i2': 'h', 'u2': 'H', 'i4': 'i', 'u4': 'I', 'i8': 'q', 'u8': 'Q',
+               'f4': 'f', 'f8': 'd', 'b1': '?'}
+
+
+class Record:
+    """Stand-in for a scikit-learn object: constructor args and pickled state"""
+
+    def __init__(self, *args):
+        self.args = args
+        self.state = {}
+
+    def __setstate__(self, state):
+        self.state = state
+
+
+class DType(Record):
+    def struct_code(self):
+        code = self.args[0]
+        order = self.state[1] if self.state and self.state[1] in '<>=' else '<'
+        return ('<' if order == '=' else order), NUMPY_TYPES[code]
+
+
+class NDArray(Record):
+    def decode(self):
+        """Flat list of items (dicts of named fields for structured arrays) and the shape"""
+        _, shape, dtype, fortran, raw = self.state
+        if fortran:
+            raise ValueError("Fortran-ordered arrays are not supported")
+        count = 1
+        for n in shape:
+            count *= n
+        if dtype.args[0].startswith('V'):
+            names, fields, itemsize = dtype.state[3], dtype.state[4], dtype.state[5]
+            layout = [(name,) + fields[name][:2] for name in names]
+            items = []
+            for i in range(count):
+                base = i * itemsize
+                items.append({name: struct.unpack_from(''.join(sub.struct_code()), raw, base + offset)[0]
+                              for name, sub, offset in layout})
+            return items, shape
+        order, code = dtype.struct_code()
+        return list(struct.unpack(f'{order}{count}{code}', raw)), shape
+
+
+def reconstruct(cls, shape, dtype):
+    return NDArray()
+
+
+def scalar(dtype, data):
+    order, code = dtype.struct_code()
+    return struct.unpack(f'{order}{code}', data)[0]
+
+
+ALLOWED = {
+    ('sklearn.ensemble._forest', 'RandomForestClassifier'),
+    ('sklearn.tree._classes', 'DecisionTreeClassifier'),
+    ('sklearn.tree._tree', 'Tree'),
+    ('sklearn.preprocessing._data', 'StandardScaler'),
+}
+
+
+class ModelUnpickler(pickle.Unpickler):
+    def find_class(self, module, name):
+        if module in ('numpy._core.multiarray', 'numpy.core.multiarray'):
+            if name == '_reconstruct':
+                return reconstruct
+            if name == 'scalar':
+                return scalar
+        if module == 'numpy' and name == 'dtype':
+            return DType
+        if module == 'numpy' and name == 'ndarray':
+            return NDArray
+        if (module, name) in ALLOWED:
+            return type(name, (Record,), {})
+        raise pickle.UnpicklingError(f"refusing to load {module}.{name}")
+
+
+def array(value):
+    return value.decode()[0] if isinstance(value, NDArray) else value
+
+
+def load_model(path):
+    """(trees, classes, n_features, mean, scale, source) from the pickle; trees are (nodes, leaf rows)"""
+    with open(path, 'rb') as f:
+        obj = ModelUnpickler(f).load()
+    classifier = obj['classifier'] if isinstance(obj, dict) else obj
+    scaler = obj.get('scaler') if isinstance(obj, dict) else None
+    kind = type(classifier).__name__
+    estimators = classifier.state['estimators_'] if kind == 'RandomForestClassifier' else [classifier]
+    if classifier.state.get('n_outputs_', 1) != 1:
+        raise ValueError("multi-output models are not supported")
+    classes = array(classifier.state['classes_'])
+
+    trees = []
+    for estimator in estimators:
+        tree = estimator.state['tree_']
+        nodes, _ = tree.state['nodes'].decode()
+        values, shape = tree.state['values'].decode()
+        n_classes = shape[2]
+        rows = []
+        for i in range(len(nodes)):
+            row = values[i * n_classes:(i + 1) * n_classes]
+            total = sum(row)
+            rows.append([v / total if total else 0.0 for v in row])
+        trees.append((nodes, rows))
+
+    mean = scale = None
+    if scaler is not None:
+        n = classifier.state['n_features_in_']
+        mean = array(scaler.state.get('mean_')) or [0.0] * n
+        scale = array(scaler.state.get('scale_')) or [1.0] * n
+    source = f"sklearn {classifier.state.get('_sklearn_version', '?')} {kind} x{len(trees)}"
+    return trees, classes, classifier.state['n_features_in_'], mean, scale, source
+
+
+def preorder(nodes):
+    """Old node ids of one tree in preorder (left subtree before right)"""
+    order, stack = [], [0]
+    while stack:
+        i = stack.pop()
+        order.append(i)
+        if nodes[i]['left_child'] != -1:
+            stack.append(nodes[i]['right_child'])
+            stack.append(nodes[i]['left_child'])
+    return order
+
+
+def fnv1a(data):
+    h = 0xcbf29ce484222325
+    for b in data:
+        h = ((h ^ b) * 0x100000001b3) & 0xffffffffffffffff
+    return h
+
+
+def export(trees, classes, n_features, mean, scale, source, positive_class):
+    roots, node_bytes, values = [], bytearray(), []
+    n_nodes = n_leaves = 0
+    for nodes, rows in trees:
+        order = preorder(nodes)
+        new_id = {old: n_nodes + k for k, old in enumerate(order)}
+        roots.append(n_nodes)
+        for old in order:
+            node = nodes[old]
+            if node['left_child'] == -1:
+                node_bytes += NODE.pack(0.0, MODEL_LEAF, n_leaves)
+                values.extend(rows[old])
+                n_leaves += 1
+            else:
+                f, t = node['feature'], node['threshold']
+                if scale is not None:
+                    t = t * scale[f] + mean[f]
+                node_bytes += NODE.pack(t, f, new_id[node['right_child']])
+        n_nodes += len(order)
+
+    def pad8(b):
+        return b + b'\0' * (-len(b) % 8)
+
+    payload = pad8(struct.pack(f'<{len(roots)}I', *roots)) + bytes(node_bytes) + \
+        pad8(struct.pack(f'<{len(values)}f', *values))
+    header = HEADER.pack(MODEL_MAGIC, MODEL_VERSION[0], MODEL_VERSION[1], HEADER.size,
+                         MODEL_FOLDED_SCALER if scale is not None else 0, n_features, len(classes),
+                         positive_class, len(roots), n_nodes, n_leaves, len(payload), fnv1a(payload),
+                         source.encode()[:63])
+    return header + payload
+
+
+def parse_exported(data):
+    """Sections of an exported model: dict with the header fields, roots, nodes and values"""
+    (magic, major, minor, header_size, flags, n_features, n_classes, positive, n_trees, n_nodes, n_leaves,
+     payload_bytes, payload_hash, source) = HEADER.unpack_from(data)
+    if magic != MODEL_MAGIC or major != MODEL_VERSION[0]:
+        raise ValueError(f"not a version {MODEL_VERSION[0]}.x model file")
+    if fnv1a(data[header_size:]) != payload_hash:
+        raise ValueError("payload hash mismatch (corrupt file)")
+    roots_bytes = (4 * n_trees + 7) & ~7
+    roots = struct.unpack_from(f'<{n_trees}I', data, header_size)
+    nodes = [NODE.unpack_from(data, header_size + roots_bytes + i * NODE.size) for i in range(n_nodes)]
+    values = struct.unpack_from(f'<{n_leaves * n_classes}f', data, header_size + roots_bytes + n_nodes * NODE.size)
+    return {'version': (major, minor), 'flags': flags, 'n_features': n_features, 'n_classes': n_classes,
+            'positive_class': positive, 'payload_hash': payload_hash,
+            'source': source.split(b'\0', 1)[0].decode(errors='replace'),
+            'roots': roots, 'nodes': nodes, 'values': values}
+
+
+def read_exported(data):
+    """Scorer over the exported bytes, walking them as the native engine does"""
+    model = parse_exported(data)
+    roots, nodes, values = model['roots'], model['nodes'], model['values']
+    n_classes, positive = model['n_classes'], model['positive_class']
+
+    def score(x):
+        total = 0.0
+        for root in roots:
+            i = root
+            while nodes[i][1] != MODEL_LEAF:
+                i = i + 1 if x[nodes[i][1]] <= nodes[i][0] else nodes[i][2]
+            total += values[nodes[i][2] * n_classes + positive]
+        return total / len(roots)
+    return score
+
+
+def reference_score(trees, mean, scale, positive, x):
+    """predict_proba of the pickled model: scaler, then float32 features as scikit-learn's trees use"""
+    if scale is not None:
+        x = [(v - m) / s for v, m, s in zip(x, mean, scale)]
+    x = [struct.unpack('f', struct.pack('f', v))[0] for v in x]
+    total = 0.0
+    for nodes, rows in trees:
+        i = 0
+        while nodes[i]['left_child'] != -1:
+            i = nodes[i]['left_child'] if x[nodes[i]['feature']] <= nodes[i]['threshold'] else nodes[i]['right_child']
+        total += rows[i][positive]
+    return total / len(trees)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Export the pickled anomaly model for the native engine')
+    parser.add_argument('--model', default='ml_model.pkl', help='pickled scikit-learn model')
+    parser.add_argument('--out', default='ml_model.bin', help='binary model to write')
+    parser.add_argument('--positive-class', type=int, default=1, help='class label scored as anomalous')
+    parser.add_argument('--check', type=int, default=0, help='compare scores on N random vectors')
+    args = parser.parse_args()
+
+    try:
+        trees, classes, n_features, mean, scale, source = load_model(args.model)
+    except (OSError, KeyError, ValueError, pickle.UnpicklingError) as e:
+        print(f"❌ {args.model}: {e}")
+        return 1
+    positive = classes.index(args.positive_class) if args.positive_class in classes else len(classes) - 1
+    data = export(trees, classes, n_features, mean, scale, source, positive)
+    with open(args.out, 'wb') as f:
+        f.write(data)
+    n_nodes = sum(len(nodes) for nodes, _ in trees)
+    print(f"💾 {args.out}: {source}, {n_features} features, {n_nodes} nodes, {len(data)} bytes "
+          f"(format {MODEL_VERSION[0]}.{MODEL_VERSION[1]})")
+
+    if args.check:
+        score = read_exported(data)
+        rng = random.Random(1)
+        center = mean or [0.0] * n_features
+        spread = scale or [1.0] * n_features
+        worst = 0.0
+        for _ in range(args.check):
+            x = [rng.gauss(m, 2 * s) for m, s in zip(center, spread)]
+            worst = max(worst, abs(score(x) - reference_score(trees, mean, scale, positive, x)))
+        print(f"🔎 {args.check} random vectors: max |exported - pickled| = {worst:.2e}")
+        if worst > 1e-6:
+            return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
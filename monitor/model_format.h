@@ -0,0 +1,66 @@
+#pragma once
+
+// Anomaly model file format (written by model_export.py, read by
+// anomaly_model.h). Little-endian, all sections 8-byte aligned:
+//
+//   ModelHeader
+//   uint32_t roots[n_trees]            first node of each tree (+ pad to 8)
+//   ModelNode nodes[n_nodes]           every tree, preorder
+//   float values[n_leaves][n_classes]  class probabilities per leaf
+//
+// Nodes are laid out in preorder, so a split's left child is the next
+// node and only the right child is stored; children always come after
+// their parent, which lets the loader prove that every walk ends. A
+// split sends x to the left child when x[feature] <= threshold. Features
+// are the raw values: the exporter folds any standardization into the
+// thresholds. payload_hash is FNV-1a 64 over everything after the header.
+//
+// A reader accepts files with its own version_major and any minor: minor
+// versions only append header fields (header_size says how many) or set
+// flags the reader may ignore.
+
+#include <cstdint>
+
+#define MODEL_MAGIC 0x4c444d41  // "AMDL"
+#define MODEL_VERSION_MAJOR 1
+#define MODEL_VERSION_MINOR 0
+#define MODEL_LEAF -1
+
+// flags
+#define MODEL_FOLDED_SCALER 0x1  // thresholds already include a StandardScaler
+
+struct ModelHeader {
+    uint32_t magic;          // MODEL_MAGIC
+    uint16_t version_major;
+    uint16_t version_minor;
+    uint32_t header_size;    // sizeof(ModelHeader) of the writer
+    uint32_t flags;
+    uint32_t n_features;
+    uint32_t n_classes;
+    uint32_t positive_class; // class whose probability is the anomaly score
+    uint32_t n_trees;
+    uint32_t n_nodes;
+    uint32_t n_leaves;
+    uint64_t payload_bytes;
+    uint64_t payload_hash;
+    char source[64];         // what the model was exported from, NUL-padded
+    uint8_t reserved[8];
+} __attribute__((packed));
+
+struct ModelNode {
+    double threshold;
+    int32_t feature;         // MODEL_LEAF for a leaf
+    uint32_t next;           // split: right child; leaf: row in values
+} __attribute__((packed));
+
+static_assert(sizeof(ModelHeader) == 128, "model header is 128 bytes");
+static_assert(sizeof(ModelNode) == 16, "model nodes are 16 bytes");
+
+static inline uint64_t model_fnv1a(const uint8_t* data, uint64_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint64_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
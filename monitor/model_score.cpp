@@ -0,0 +1,172 @@
+// Native anomaly scorer
+// =====================
+//
+// Scores feature vectors with an exported model (model_export.py ->
+// ml_model.bin) through the same engine the agent can embed
+// (anomaly_model.h), with no Python in the loop.
+//
+// Input is one vector per line, comma- or space-separated, n_features
+// values each; lines starting with '#' are skipped. Output is one line
+// per vector: the anomaly probability and, with --threshold, 1 when it
+// is reached. --bench N instead times N random vectors and prints the
+// cost per vector.
+//
+// --engine compiled scores with the model built into this binary by
+// model_codegen.py (ml_model_gen.h, present after `make model`) instead
+// of the file; --bench runs both engines on the same vectors and checks
+// that they agree.
+//
+// Usage: model_score [--model ml_model.bin] [--engine interpreted|compiled] [--input FILE]
+//                    [--threshold P] [--bench N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <random>
+#include <vector>
+#include "anomaly_model.h"
+#if __has_include("ml_model_gen.h")
+#include "ml_model_gen.h"
+#define HAVE_COMPILED_MODEL 1
+#endif
+
+static const char* arg_value(int argc, char** argv, const char* name, const char* fallback) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], name) == 0) return argv[i + 1];
+    }
+    return fallback;
+}
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Parses up to n values from line; returns how many were read
+static uint32_t parse_vector(char* line, double* x, uint32_t n) {
+    uint32_t count = 0;
+    char* p = line;
+    while (count < n) {
+        while (*p == ' ' || *p == ',' || *p == '\t') p++;
+        char* end;
+        double v = strtod(p, &end);
+        if (end == p) break;
+        x[count++] = v;
+        p = end;
+    }
+    return count;
+}
+
+enum Engine { ENGINE_INTERPRETED, ENGINE_COMPILED };
+static const char* ENGINE_NAMES[] = {"interpreted", "compiled"};
+
+static inline double score_with(Engine engine, const AnomalyModel* model, const double* x) {
+#ifdef HAVE_COMPILED_MODEL
+    if (engine == ENGINE_COMPILED) return ml_model_gen::score(x);
+#endif
+    (void)engine;
+    return anomaly_model_score(model, x);
+}
+
+static double bench_engine(Engine engine, const AnomalyModel* model, const std::vector<double>& inputs,
+                           uint64_t distinct, uint64_t vectors) {
+    volatile double sink = 0;
+    uint64_t start = now_ns();
+    for (uint64_t i = 0; i < vectors; i++) {
+        sink = sink + score_with(engine, model, &inputs[(i % distinct) * model->n_features]);
+    }
+    double ns = (double)(now_ns() - start) / vectors;
+    printf("⏱️  %-11s %lu vectors, %u trees: %.1f ns/vector (%.2f ns/tree)\n", ENGINE_NAMES[engine],
+           (unsigned long)vectors, model->n_trees, ns, ns / model->n_trees);
+    return ns;
+}
+
+static int bench(const AnomalyModel* model, bool compiled, uint64_t vectors) {
+    // Spread over several magnitudes so walks take both branches
+    std::mt19937_64 rng(42);
+    std::lognormal_distribution<double> value(6.0, 3.0);
+    const uint64_t distinct = 4096;
+    std::vector<double> inputs(distinct * model->n_features);
+    for (double& v : inputs) v = value(rng);
+
+    double interpreted_ns = bench_engine(ENGINE_INTERPRETED, model, inputs, distinct, vectors);
+    if (!compiled) return 0;
+    for (uint64_t i = 0; i < distinct; i++) {
+        const double* x = &inputs[i * model->n_features];
+        if (score_with(ENGINE_COMPILED, model, x) != anomaly_model_score(model, x)) {
+            fprintf(stderr, "❌ engines disagree on vector %lu\n", (unsigned long)i);
+            return 1;
+        }
+    }
+    double compiled_ns = bench_engine(ENGINE_COMPILED, model, inputs, distinct, vectors);
+    printf("   compiled is %.1fx faster, same scores on %lu vectors\n", interpreted_ns / compiled_ns,
+           (unsigned long)distinct);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* path = arg_value(argc, argv, "--model", "ml_model.bin");
+    const char* input = arg_value(argc, argv, "--input", nullptr);
+    const char* threshold_arg = arg_value(argc, argv, "--threshold", nullptr);
+    uint64_t bench_vectors = strtoull(arg_value(argc, argv, "--bench", "0"), nullptr, 10);
+    const char* engine_arg = arg_value(argc, argv, "--engine", "interpreted");
+    Engine engine = strcmp(engine_arg, "compiled") == 0 ? ENGINE_COMPILED : ENGINE_INTERPRETED;
+    if (engine == ENGINE_INTERPRETED && strcmp(engine_arg, "interpreted") != 0) {
+        fprintf(stderr, "❌ unknown engine %s (interpreted or compiled)\n", engine_arg);
+        return 1;
+    }
+
+    AnomalyModel model;
+    char err[256];
+    if (!anomaly_model_load(&model, path, err, sizeof(err))) {
+        fprintf(stderr, "❌ %s: %s\n", path, err);
+        return 1;
+    }
+    fprintf(stderr, "✅ %s: %.64s, format %u.%u, %u features, %u trees\n", path, model.header->source,
+            model.header->version_major, model.header->version_minor, model.n_features, model.n_trees);
+    // The compiled model is only a stand-in for the file it was generated from
+    bool compiled = false;
+#ifdef HAVE_COMPILED_MODEL
+    compiled = ml_model_gen::kPayloadHash == model.header->payload_hash;
+    if (!compiled) fprintf(stderr, "⚠️  compiled model was generated from a different file\n");
+#endif
+    if (engine == ENGINE_COMPILED && !compiled) {
+        fprintf(stderr, "❌ no compiled model for %s (run make model)\n", path);
+        anomaly_model_unload(&model);
+        return 1;
+    }
+    if (bench_vectors) {
+        int rc = bench(&model, compiled, bench_vectors);
+        anomaly_model_unload(&model);
+        return rc;
+    }
+
+    FILE* in = input ? fopen(input, "r") : stdin;
+    if (!in) {
+        fprintf(stderr, "❌ cannot open %s\n", input);
+        anomaly_model_unload(&model);
+        return 1;
+    }
+    double threshold = threshold_arg ? atof(threshold_arg) : 0;
+    std::vector<double> x(model.n_features);
+    char line[4096];
+    uint64_t line_no = 0;
+    int rc = 0;
+    while (fgets(line, sizeof(line), in)) {
+        line_no++;
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (parse_vector(line, x.data(), model.n_features) != model.n_features) {
+            fprintf(stderr, "❌ line %lu: expected %u values\n", (unsigned long)line_no, model.n_features);
+            rc = 1;
+            continue;
+        }
+        double score = score_with(engine, &model, x.data());
+        if (threshold_arg) printf("%.6f,%d\n", score, score >= threshold ? 1 : 0);
+        else printf("%.6f\n", score);
+    }
+    if (input) fclose(in);
+    anomaly_model_unload(&model);
+    return rc;
+}
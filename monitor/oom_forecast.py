@@ -0,0 +1,331 @@
+#!/usr/bin/env python3
+"""
+OOM time-to-exhaustion forecast
+===============================
+
+Once per interval this reads the advanced agent's header snapshot
+(live heap bytes, shm_layout.h HeaderSnapshot) along with the process's
+memory usage and limit. It estimates how long the process has before it
+reaches the limit.
+
+Usage and limit come from the process's memory cgroup (memory.current
+and memory.max on v2, memory.usage_in_bytes and memory.limit_in_bytes on
+v1). The tightest limit along the cgroup path wins. Without a cgroup
+limit the host's MemTotal is used, and usage falls back to RSS.
+
+Each series is fitted with an exponentially weighted linear regression
+(half-life --half-life seconds). The running sums are updated in O(1)
+per sample, so one update costs a 64-byte shm read and a few small
+/proc and cgroup files. The forecast projects the heap trend onto the
+remaining headroom:
+
+    eta = (limit - usage) / heap slope
+
+The interval [early, late] comes from the slope's confidence interval
+(--confidence). The slope's standard error assumes independent
+residuals, so treat the interval as optimistic when memory moves in
+steps. The usage trend gets its own eta, which covers growth that
+doesn't go through malloc (mmap, thread stacks, page cache charged to
+the cgroup).
+
+For orchestrators: --out keeps the latest forecast in a JSON file
+(replaced atomically). drain is true once the early bound falls below
+--drain-below seconds.
+
+Usage: oom_forecast.py [--interval S] [--half-life S] [--confidence P] [--drain-below S]
+                       [--pid PID] [--limit BYTES] [--out FILE] [--once-after S] [--json]
+"""
+
+import argparse
+import json
+import math
+import mmap
+import os
+import sys
+import time
+from statistics import NormalDist
+
+from agent_stats import SEGMENTS, check_segment, read_header_snapshot
+
+UNLIMITED = 1 << 62  # cgroup v1 reports "no limit" as a huge page-aligned value
+
+
+def read_snapshot(shm):
+    """Seqlock read of the header snapshot: (pid, current_memory, publish_ns) or None"""
+    snapshot = read_header_snapshot(shm)
+    return (snapshot[0], snapshot[3], snapshot[6]) if snapshot else None
+
+
+def read_int(path):
+    try:
+        with open(path) as f:
+            value = f.read().strip()
+        return None if value == 'max' else int(value)
+    except (OSError, ValueError):
+        return None
+
+
+def cgroup_memory(pid):
+    """(usage, limit, source) of the process's memory cgroup; None fields if unknown"""
+    try:
+        with open(f'/proc/{pid}/cgroup') as f:
+            lines = [line.rstrip('\n').split(':', 2) for line in f]
+    except OSError:
+        return None, None, None
+    for _, controllers, path in lines:
+        if controllers == 'memory':
+            root, usage_file, limit_file, source = '/sys/fs/cgroup/memory', 'memory.usage_in_bytes', \
+                'memory.limit_in_bytes', 'cgroup v1'
+            break
+    else:
+        path = next((p for _, c, p in lines if c == ''), None)
+        if path is None:
+            return None, None, None
+        root, usage_file, limit_file, source = '/sys/fs/cgroup', 'memory.current', 'memory.max', 'cgroup v2'
+
+    # Nested limits all apply: take the tightest on the way up
+    usage, limit = None, None
+    parts = [p for p in path.split('/') if p]
+    for depth in range(len(parts), -1, -1):
+        directory = os.path.join(root, *parts[:depth])
+        if usage is None:
+            usage = read_int(os.path.join(directory, usage_file))
+        value = read_int(os.path.join(directory, limit_file))
+        if value is not None and value < UNLIMITED and (limit is None or value < limit):
+            limit = value
+    return usage, limit, source if limit is not None else None
+
+
+def rss_bytes(pid):
+    try:
+        with open(f'/proc/{pid}/statm') as f:
+            return int(f.read().split()[1]) * os.sysconf('SC_PAGE_SIZE')
+    except (OSError, ValueError, IndexError):
+        return None
+
+
+def host_memory():
+    try:
+        with open('/proc/meminfo') as f:
+            for line in f:
+                if line.startswith('MemTotal:'):
+                    return int(line.split()[1]) * 1024
+    except (OSError, ValueError):
+        pass
+    return None
+
+
+class TrendFit:
+    """Exponentially weighted least-squares line through (t, y), O(1) per sample"""
+
+    def __init__(self, half_life):
+        self.decay_rate = math.log(2) / half_life
+        self.t0 = self.y0 = None
+        self.last_t = None
+        # Weighted sums of 1, t, y, t^2, t*y, y^2 and, for the slope's variance, of w^2, w^2 t, w^2 t^2
+        self.w = self.t = self.y = self.tt = self.ty = self.yy = 0.0
+        self.w2 = self.w2t = self.w2tt = 0.0
+        self.samples = 0
+
+    def add(self, t, y):
+        if self.t0 is None:
+            self.t0, self.y0 = t, y  # centered, so the sums keep their precision
+        t, y = t - self.t0, y - self.y0
+        if self.last_t is not None:
+            decay = math.exp(-self.decay_rate * (t - self.last_t))
+            self.w, self.t, self.y = self.w * decay, self.t * decay, self.y * decay
+            self.tt, self.ty, self.yy = self.tt * decay, self.ty * decay, self.yy * decay
+            self.w2, self.w2t, self.w2tt = self.w2 * decay ** 2, self.w2t * decay ** 2, self.w2tt * decay ** 2
+        self.last_t = t
+        self.w += 1
+        self.t += t
+        self.y += y
+        self.tt += t * t
+        self.ty += t * y
+        self.yy += y * y
+        self.w2 += 1
+        self.w2t += t
+        self.w2tt += t * t
+        self.samples += 1
+
+    def slope(self):
+        """(slope per second, standard error) or None with too few samples"""
+        if self.samples < 3:
+            return None
+        t_mean = self.t / self.w
+        stt = self.tt - self.t * t_mean
+        if stt <= 0:
+            return None
+        sty = self.ty - self.t * self.y / self.w
+        syy = self.yy - self.y * self.y / self.w
+        slope = sty / stt
+        n_eff = self.w * self.w / self.w2
+        if n_eff <= 2:
+            return slope, math.inf
+        residual_var = max(0.0, syy - slope * sty) / self.w * n_eff / (n_eff - 2)
+        spread = self.w2tt - 2 * t_mean * self.w2t + t_mean * t_mean * self.w2
+        return slope, math.sqrt(residual_var * spread) / stt
+
+
+def eta(headroom, fit, z):
+    """(eta, early, late) in seconds for headroom bytes at the fitted slope; None = not heading there"""
+    result = fit.slope()
+    if result is None or headroom is None:
+        return None, None, None
+    slope, stderr = result
+    high, low = slope + z * stderr, slope - z * stderr
+    point = headroom / slope if slope > 0 else None
+    early = headroom / high if high > 0 else None
+    late = headroom / low if low > 0 else None
+    return point, early, late
+
+
+class OomForecaster:
+    def __init__(self, half_life=60.0, confidence=0.95, drain_below=0.0, limit=None):
+        self.heap = TrendFit(half_life)
+        self.usage = TrendFit(half_life)
+        self.z = NormalDist().inv_cdf((1 + confidence) / 2)
+        self.confidence = confidence
+        self.drain_below = drain_below
+        self.fixed_limit = limit
+        self.last_publish_ns = None
+
+    def update(self, now, pid, heap_bytes, publish_ns):
+        """Feeds one sample; returns the forecast dict"""
+        usage, limit, source = cgroup_memory(pid)
+        rss = rss_bytes(pid)
+        if usage is None or limit is None:
+            usage = rss
+        if self.fixed_limit:
+            limit, source = self.fixed_limit, '--limit'
+        elif limit is None:
+            limit, source = host_memory(), 'host'
+
+        # A stalled scanner republishes nothing: don't count the same point twice
+        if publish_ns != self.last_publish_ns:
+            self.heap.add(publish_ns / 1e9, heap_bytes)
+            self.last_publish_ns = publish_ns
+        if usage is not None:
+            self.usage.add(now, usage)
+
+        headroom = max(0, limit - usage) if limit is not None and usage is not None else None
+        heap_fit, usage_fit = self.heap.slope(), self.usage.slope()
+        point, early, late = eta(headroom, self.heap, self.z)
+        usage_point, usage_early, usage_late = eta(headroom, self.usage, self.z)
+        return {
+            'pid': pid,
+            'heap_bytes': heap_bytes,
+            'rss_bytes': rss,
+            'usage_bytes': usage,
+            'limit_bytes': limit,
+            'limit_source': source,
+            'headroom_bytes': headroom,
+            'heap_slope': round(heap_fit[0], 1) if heap_fit else None,
+            'heap_slope_stderr': round(heap_fit[1], 1) if heap_fit else None,
+            'usage_slope': round(usage_fit[0], 1) if usage_fit else None,
+            'confidence': self.confidence,
+            'eta_s': point,
+            'eta_early_s': early,
+            'eta_late_s': late,
+            'usage_eta_s': usage_point,
+            'usage_eta_early_s': usage_early,
+            'usage_eta_late_s': usage_late,
+            'drain': bool(self.drain_below and early is not None and early < self.drain_below),
+        }
+
+
+def format_bytes(n):
+    if n is None:
+        return '?'
+    for unit in ('B', 'KB', 'MB', 'GB'):
+        if abs(n) < 1024 or unit == 'GB':
+            return f"{n:.0f} {unit}" if unit == 'B' else f"{n:.1f} {unit}"
+        n /= 1024
+
+
+def format_duration(seconds):
+    if seconds is None:
+        return '∞'
+    if seconds < 120:
+        return f"{seconds:.0f}s"
+    if seconds < 7200:
+        return f"{seconds / 60:.0f}m"
+    if seconds < 172800:
+        return f"{seconds / 3600:.1f}h"
+    return f"{seconds / 86400:.1f}d"
+
+
+def print_forecast(f):
+    slope = f"{format_bytes(f['heap_slope'])}/s ±{format_bytes(f['heap_slope_stderr'])}" \
+        if f['heap_slope'] is not None else 'fitting...'
+    print(f"⏳ pid {f['pid']}: heap {format_bytes(f['heap_bytes'])} ({slope}), usage "
+          f"{format_bytes(f['usage_bytes'])} of {format_bytes(f['limit_bytes'])} ({f['limit_source']}): "
+          f"limit in {format_duration(f['eta_s'])} [{format_duration(f['eta_early_s'])}, "
+          f"{format_duration(f['eta_late_s'])}], usage trend {format_duration(f['usage_eta_s'])}"
+          f"{'  🚰 DRAIN' if f['drain'] else ''}")
+
+
+def write_atomically(path, forecast):
+    tmp = f"{path}.tmp"
+    with open(tmp, 'w') as f:
+        json.dump(forecast, f)
+    os.replace(tmp, path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Time until the process reaches its memory limit')
+    parser.add_argument('--interval', type=float, default=1.0, help='update period in seconds')
+    parser.add_argument('--half-life', type=float, default=60.0, help='trend memory in seconds')
+    parser.add_argument('--confidence', type=float, default=0.95, help='confidence of the eta interval')
+    parser.add_argument('--drain-below', type=float, default=0, help='set drain when the early eta is below this')
+    parser.add_argument('--pid', type=int, help='process to read usage for (default: from the agent)')
+    parser.add_argument('--limit', type=int, help='memory limit in bytes (default: cgroup, else host)')
+    parser.add_argument('--out', help='keep the latest forecast in this JSON file')
+    parser.add_argument('--once-after', type=float, default=0,
+                        help='update for this many seconds, print once and exit')
+    parser.add_argument('--json', action='store_true', help='print JSON instead of a line')
+    args = parser.parse_args()
+
+    path = SEGMENTS['advanced'][0]
+    try:
+        fd = os.open(path, os.O_RDONLY)
+    except FileNotFoundError:
+        print(f"❌ {path} not found: is a process running with the advanced agent?")
+        return 1
+    error = check_segment(fd, 'advanced')
+    if error:
+        print(f"❌ {error}")
+        return 1
+    shm = mmap.mmap(fd, 0, access=mmap.ACCESS_READ)
+    forecaster = OomForecaster(args.half_life, args.confidence, args.drain_below, args.limit)
+    start = time.monotonic()
+
+    try:
+        while True:
+            snapshot = read_snapshot(shm)
+            if not snapshot or not snapshot[2]:
+                print("❌ Header snapshot missing or not published yet (older agent build?)")
+                return 1
+            pid, heap_bytes, publish_ns = snapshot
+            now = time.monotonic()
+            forecast = forecaster.update(now, args.pid or pid, heap_bytes, publish_ns)
+            if args.out:
+                write_atomically(args.out, forecast)
+            if not args.once_after or now - start >= args.once_after:
+                if args.json:
+                    print(json.dumps(forecast))
+                else:
+                    print_forecast(forecast)
+                if args.once_after:
+                    break
+            time.sleep(args.interval)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        shm.close()
+        os.close(fd)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,132 @@
+#pragma once
+
+// Per-CPU allocation counters (see CpuCounters in shm_layout.h).
+//
+// With rseq (glibc >= 2.35 registers it for every thread) an add is a
+// restartable sequence: read the current CPU from the thread's rseq
+// area, then a single non-atomic add into that CPU's slot as the commit
+// instruction. If the thread is preempted, migrated or signalled before
+// the commit, the kernel restarts it at the abort handler and we retry,
+// so totals are exact without a locked instruction. Without rseq each
+// thread takes its own slot and uses uncontended atomic adds.
+
+#include <stddef.h>
+#include <cstdint>
+#include "shm_layout.h"
+
+#if defined(__x86_64__) && defined(__GNUC__) && __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#define AGENT_HAVE_RSEQ 1
+#endif
+
+static CpuCounters* cpu_counters = nullptr;
+// Used when the shm segment can't be created, so totals still work
+static CpuCounters local_cpu_counters;
+static int next_counter_slot = 0;
+static __thread int counter_thread_slot __attribute__((tls_model("initial-exec"))) = -1;
+
+#ifdef AGENT_HAVE_RSEQ
+// Returns 1 when committed, 0 when aborted (retry), -1 when the CPU has
+// no slot of its own
+static inline int percpu_rseq_add(uint64_t* base, int64_t delta) {
+    __asm__ __volatile__ goto(
+        ".pushsection __rseq_cs, \"aw\"\n\t"
+        ".balign 32\n\t"
+        "3:\n\t"
+        ".long 0x0, 0x0\n\t"                        // version, flags
+        ".quad 1f, (2f - 1f), 4f\n\t"               // start, post-commit offset, abort
+        ".popsection\n\t"
+        "leaq 3b(%%rip), %%rax\n\t"
+        "movq %%rax, %%fs:8(%[rseq_offset])\n\t"    // rseq->rseq_cs = &descriptor
+        "1:\n\t"
+        "movl %%fs:4(%[rseq_offset]), %%eax\n\t"    // rseq->cpu_id
+        "cmpl %[max_cpus], %%eax\n\t"
+        "jae %l[no_slot]\n\t"
+        "shlq $6, %%rax\n\t"                        // sizeof(CpuCounterSlot)
+        "addq %[delta], (%[base], %%rax)\n\t"       // commit
+        "2:\n\t"
+        ".pushsection __rseq_failure, \"ax\"\n\t"
+        ".byte 0x0f, 0xb9, 0x3d\n\t"                // ud1: signature must precede the handler
+        ".long 0x53053053\n\t"                      // RSEQ_SIG
+        "4:\n\t"
+        "jmp %l[aborted]\n\t"
+        ".popsection\n\t"
+        :
+        : [rseq_offset] "r"(__rseq_offset), [delta] "r"(delta), [base] "r"(base), [max_cpus] "i"(AGENT_MAX_CPUS)
+        : "memory", "cc", "rax"
+        : aborted, no_slot);
+    return 1;
+aborted:
+    return 0;
+no_slot:
+    return -1;
+}
+#endif
+
+static inline void percpu_add(int counter, int64_t delta) {
+    CpuCounters* counters = cpu_counters;
+    if (!counters) return;
+
+#ifdef AGENT_HAVE_RSEQ
+    if (counters->mode == CPU_COUNTERS_RSEQ) {
+        int committed;
+        uint64_t* base = (uint64_t*)((char*)counters->slots + counter * sizeof(uint64_t));
+        while ((committed = percpu_rseq_add(base, delta)) == 0) {
+        }
+        if (committed > 0) return;
+        __atomic_fetch_add(&counters->slots[AGENT_MAX_CPUS].value[counter], delta, __ATOMIC_RELAXED);
+        return;
+    }
+#endif
+
+    if (counter_thread_slot < 0) {
+        counter_thread_slot = __atomic_fetch_add(&next_counter_slot, 1, __ATOMIC_RELAXED) % CPU_COUNTER_SLOTS;
+    }
+    __atomic_fetch_add(&counters->slots[counter_thread_slot].value[counter], delta, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t percpu_sum(int counter) {
+    CpuCounters* counters = cpu_counters;
+    if (!counters) return 0;
+    uint64_t sum = 0;
+    for (int i = 0; i < CPU_COUNTER_SLOTS; i++) {
+        sum += __atomic_load_n(&counters->slots[i].value[counter], __ATOMIC_RELAXED);
+    }
+    return sum;
+}
+
+// All counters in one pass over the slots, so they are read close
+// together (not atomically: adds can land between two counters' reads)
+static inline void percpu_sum_all(uint64_t sums[NUM_CPU_COUNTERS]) {
+    for (int c = 0; c < NUM_CPU_COUNTERS; c++) sums[c] = 0;
+    CpuCounters* counters = cpu_counters;
+    if (!counters) return;
+    for (int i = 0; i < CPU_COUNTER_SLOTS; i++) {
+        for (int c = 0; c < NUM_CPU_COUNTERS; c++) {
+            sums[c] += __atomic_load_n(&counters->slots[i].value[c], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// area: zeroed CpuCounters in shm, or nullptr to count locally only
+static inline void percpu_counters_init(CpuCounters* area) {
+    if (!area) area = &local_cpu_counters;
+    area->mode = CPU_COUNTERS_PER_THREAD;
+#ifdef AGENT_HAVE_RSEQ
+    if (__rseq_size >= 8 && getenv("AGENT_NO_RSEQ") == nullptr) area->mode = CPU_COUNTERS_RSEQ;
+#endif
+    area->num_slots = CPU_COUNTER_SLOTS;
+    __atomic_store_n(&area->magic, CPU_COUNTERS_MAGIC, __ATOMIC_RELEASE);
+    cpu_counters = area;
+}
+
+// Totals live on after the segment is unmapped: fold them into the local area
+static inline void percpu_counters_detach() {
+    CpuCounters* counters = cpu_counters;
+    if (!counters || counters == &local_cpu_counters) return;
+    local_cpu_counters.mode = CPU_COUNTERS_PER_THREAD;
+    for (int c = 0; c < NUM_CPU_COUNTERS; c++) local_cpu_counters.slots[0].value[c] = percpu_sum(c);
+    local_cpu_counters.num_slots = CPU_COUNTER_SLOTS;
+    local_cpu_counters.magic = CPU_COUNTERS_MAGIC;
+    cpu_counters = &local_cpu_counters;
+}
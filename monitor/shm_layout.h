@@ -0,0 +1,524 @@
+#pragma once
+
+// Shared memory layouts published by the agents.
+// Every struct here is read byte-for-byte by the Python analyzers
+// (struct.Struct formats) and by the native readers, so field order and
+// packing are part of the wire format: append, never reorder.
+
+#include <cstdint>
+#include <stddef.h>
+
+// ========================================
+// AGENT SELF-INSTRUMENTATION (both agents)
+// ========================================
+
+// Time spent inside the agent, as log2 histograms of CPU cycles (TSC on
+// x86, nanoseconds elsewhere): bucket i counts samples in [2^i, 2^(i+1)).
+// Every call is counted, one call in 2^sample_shift is timed.
+// Appended at the end of each agent's segment, 8-byte aligned.
+#define AGENT_STATS_MAGIC 0x53545441  // "ATTS"
+#define AGENT_HIST_BUCKETS 48
+#define AGENT_MAX_PROBES 8
+
+enum AgentProbe {
+    PROBE_MALLOC_HOOK = 0,   // whole malloc hook, including the real malloc
+    PROBE_FREE_HOOK = 1,     // whole free hook, including the real free
+    PROBE_PUBLISH = 2,       // write_to_shared_memory / write_leak_event
+    PROBE_SCAN = 3,          // one leak scanner tick
+    NUM_AGENT_PROBES = 4
+};
+
+struct AgentHistogram {
+    uint64_t count;          // calls
+    uint64_t samples;        // timed calls, summed in total_cycles/buckets
+    uint64_t total_cycles;
+    uint64_t max_cycles;
+    uint64_t buckets[AGENT_HIST_BUCKETS];
+} __attribute__((packed));
+
+struct AgentStats {
+    uint32_t magic;          // AGENT_STATS_MAGIC once initialized
+    uint32_t num_probes;     // probes[] entries in use
+    uint64_t cycles_per_sec; // converts cycles to time; 0 until the first flush, then refreshed
+    uint32_t sample_shift;   // one call in 2^sample_shift is timed
+    uint32_t reserved;
+    AgentHistogram probes[AGENT_MAX_PROBES];
+} __attribute__((packed));
+
+// ========================================
+// PER-CPU COUNTERS (both agents)
+// ========================================
+
+// Allocation totals without shared read-modify-writes: each CPU adds to
+// its own cache line through a restartable sequence (rseq), or each
+// thread to its own line when rseq is unavailable. Readers sum all slots
+// (modulo 2^64; signed counters wrap back to the right value). The last
+// slot takes CPUs beyond AGENT_MAX_CPUS with atomic adds.
+#define CPU_COUNTERS_MAGIC 0x55504350  // "PCPU"
+#define AGENT_MAX_CPUS 256
+#define CPU_COUNTER_SLOTS (AGENT_MAX_CPUS + 1)
+
+enum CpuCounterMode {
+    CPU_COUNTERS_RSEQ = 1,        // slot = current CPU
+    CPU_COUNTERS_PER_THREAD = 2   // slot = per-thread index, atomic adds
+};
+
+enum CpuCounter {
+    CTR_ALLOCATIONS = 0,
+    CTR_FREES = 1,
+    CTR_BYTES_ALLOCATED = 2,     // basic agent: bytes requested through malloc
+    CTR_CURRENT_BYTES = 3,       // advanced agent: live bytes (signed)
+    NUM_CPU_COUNTERS = 8
+};
+
+struct CpuCounterSlot {
+    uint64_t value[NUM_CPU_COUNTERS];
+} __attribute__((packed));
+
+struct CpuCounters {
+    uint32_t magic;          // CPU_COUNTERS_MAGIC once initialized
+    uint32_t mode;           // CpuCounterMode
+    uint32_t num_slots;      // CPU_COUNTER_SLOTS
+    uint8_t reserved[52];    // slots start on a cache line
+    CpuCounterSlot slots[CPU_COUNTER_SLOTS];
+} __attribute__((packed));
+
+// Padding that puts the next member on a 64-byte boundary
+#define SHM_PAD_TO_64(used) (64 - (used) % 64)
+
+// ========================================
+// BASIC AGENT (agent.cpp)
+// ========================================
+
+#define BASIC_SHM_NAME "/ml_runtime_shm"
+
+// Data structure for shared memory using fixed-size types
+// malloc_count and total_bytes are the publishing thread's own running
+// totals, so they are exact and increase per thread but not across the
+// ring; process-wide totals are the cpu_counters sums
+struct AllocationData {
+    int32_t malloc_count;    // mallocs of this thread, including this one
+    uint64_t size;
+    uint64_t total_bytes;    // bytes this thread has malloc'd so far
+    int64_t timestamp;       // Wall clock seconds
+    int32_t is_valid;        // 0=empty, 1=valid data
+    uint64_t publish_ns;     // CLOCK_MONOTONIC when the record was published
+} __attribute__((packed));
+
+#define BUFFER_SIZE 1000
+struct SharedBuffer {
+    // Moved indexes to the top to match Python analyzer's expectation
+    volatile int write_index;
+    volatile int read_index;
+    AllocationData allocations[BUFFER_SIZE];
+    AgentStats stats;
+    uint8_t reserved0[SHM_PAD_TO_64(8 + sizeof(AllocationData) * BUFFER_SIZE + sizeof(AgentStats))];
+    CpuCounters cpu_counters;
+} __attribute__((packed));
+
+// ========================================
+// ADVANCED AGENT (advanced_agent.cpp)
+// ========================================
+
+#define ADVANCED_SHM_NAME "/ml_advanced_leak_detection"
+
+// Metadata structure embedded in each allocation
+struct AllocationMeta {
+    uint32_t magic;          // Magic number for validation (0xDEADBEEF)
+    size_t size;             // Original allocation size
+    uint64_t alloc_time;     // Allocation timestamp (nanoseconds)
+    uint64_t last_access;    // Last access timestamp
+    uint32_t site_id;        // Call site identifier
+    uint32_t thread_id;      // Thread that allocated
+} __attribute__((packed));
+
+// Event types for shared memory logging
+enum EventType {
+    EVENT_MALLOC = 1,
+    EVENT_FREE = 2,
+    EVENT_LEAK_DETECTED = 3,
+    EVENT_ACCESS_PATTERN = 4
+};
+
+// Event structure for shared memory
+struct LeakEvent {
+    int32_t event_id;
+    int32_t event_type;
+    uint64_t timestamp;      // CLOCK_MONOTONIC ns, taken when the event is published
+    uint32_t thread_id;
+
+    union {
+        struct {
+            void* address;
+            size_t size;
+            uint64_t staleness_ns;
+            uint32_t site_id;
+        } leak;
+
+        struct {
+            void* address;
+            size_t size;
+            uint64_t alloc_time;
+            uint32_t site_id;
+        } allocation;
+    } data;
+
+    int32_t is_valid;
+} __attribute__((packed));
+
+// Optional allocator profile (ALLOC_PROFILE=1): time spent inside the
+// real malloc/free per size class, and calls slower than outlier_cycles
+// attributed to the allocation site. Size class i covers
+// [2^(i+4), 2^(i+5)) bytes; the first and last classes are open-ended.
+#define ALLOC_PROFILE_MAGIC 0x464f5250  // "PROF"
+#define ALLOC_SIZE_CLASSES 16
+#define ALLOC_OUTLIER_SITES 256
+
+enum AllocOp {
+    ALLOC_OP_MALLOC = 0,
+    ALLOC_OP_FREE = 1
+};
+
+struct AllocOutlierSite {
+    uint32_t key;            // 0 = empty, else (site_id << 1 | op) + 1
+    uint32_t site_id;
+    uint32_t op;             // AllocOp
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t total_cycles;
+    uint64_t max_cycles;
+    uint64_t max_size;
+} __attribute__((packed));
+
+struct AllocatorProfile {
+    uint32_t magic;          // ALLOC_PROFILE_MAGIC once initialized
+    uint32_t enabled;
+    uint64_t outlier_cycles; // calls above this are outliers
+    uint64_t outlier_overflow; // outliers dropped because the site table was full
+    AgentHistogram latency[2][ALLOC_SIZE_CLASSES];  // [AllocOp][size class]
+    AllocOutlierSite outlier_sites[ALLOC_OUTLIER_SITES];
+} __attribute__((packed));
+
+// Header aggregates as one untorn snapshot, published by the scanner every
+// 10 ms and after each scan under a seqlock: seq is odd while an update is
+// in progress. Readers copy the fields between two reads of seq and retry
+// if it changed or was odd; the writer never waits for them. Each total is
+// exact, but the hooks bump allocations, frees and current bytes
+// separately and the scanner sums them in one pass that isn't atomic, so
+// allocations - frees and current_memory may disagree by the few calls in
+// flight during that pass.
+#define HEADER_SNAPSHOT_MAGIC 0x50414e53  // "SNAP"
+
+struct HeaderSnapshot {
+    uint32_t magic;          // HEADER_SNAPSHOT_MAGIC once initialized
+    uint32_t pid;            // process the agent runs in
+    uint64_t seq;
+    uint64_t total_allocations;
+    uint64_t total_frees;
+    uint64_t current_memory;
+    uint64_t leak_count;
+    uint64_t events_written; // write_index when the snapshot was taken
+    uint64_t publish_ns;     // CLOCK_MONOTONIC
+} __attribute__((packed));
+
+// Allocation and free sizes as HDR-style histograms: log2 ranges split
+// into 2^SIZE_HIST_SUB_BITS linear sub-buckets (<= 25% relative error).
+// Sizes below 4 get a bucket each; size s >= 4 with e = floor(log2 s)
+// lands in 4 + (e - 2) * 4 + ((s >> (e - 2)) & 3). The last bucket is
+// open-ended. Each thread owns a slot and updates it without atomics
+// (the shared last slot takes threads beyond SIZE_HIST_THREAD_SLOTS);
+// readers merge all slots.
+#define SIZE_HIST_MAGIC 0x54534948  // "HIST"
+#define SIZE_HIST_SUB_BITS 2
+#define SIZE_HIST_BUCKETS 192
+#define SIZE_HIST_THREAD_SLOTS 32
+#define SIZE_HIST_SLOTS (SIZE_HIST_THREAD_SLOTS + 1)
+
+struct SizeHistogramSlot {
+    uint64_t counts[2][SIZE_HIST_BUCKETS];  // [AllocOp][bucket]
+} __attribute__((packed));
+
+struct SizeHistograms {
+    uint32_t magic;          // SIZE_HIST_MAGIC once initialized
+    uint32_t num_slots;      // SIZE_HIST_SLOTS
+    uint32_t sub_bucket_bits;
+    uint32_t num_buckets;
+    uint32_t slots_claimed;  // threads that asked for a slot
+    uint8_t reserved[44];    // slots start on a cache line
+    SizeHistogramSlot slots[SIZE_HIST_SLOTS];
+} __attribute__((packed));
+
+// Per-site quantile sketches (DDSketch-style) of allocation size and of
+// lifetime (free time - alloc_time, in microseconds). Bins use the same
+// log-linear mapping as SizeHistograms with SITE_SKETCH_SUB_BITS, over a
+// fixed range (values past the last bin collapse into it), so any two
+// sketches merge by adding bins: across threads, processes and hosts.
+// A quantile read back as its bin's midpoint is within ~12% of the true
+// value. Sites are keyed by site_id; the scanner fills in module and
+// module_offset so readers can merge the same site from other processes.
+#define SITE_SKETCH_MAGIC 0x48434b53  // "SKCH"
+#define SITE_SKETCH_SUB_BITS 2
+#define SITE_SKETCH_BINS 160         // up to 2^41 bytes / microseconds
+#define SITE_TABLE_SIZE 256
+#define SITE_MODULE_NAME 32
+
+struct QuantileSketch {
+    uint64_t count;
+    uint64_t sum;
+    uint32_t bins[SITE_SKETCH_BINS];
+} __attribute__((packed));
+
+struct SiteSketches {
+    uint32_t key;            // 0 = empty, else site_id + 1
+    uint32_t site_id;
+    uint64_t caller;         // return address of the first allocation seen
+    uint64_t module_offset;  // caller - module load address, once resolved
+    char module[SITE_MODULE_NAME];  // module basename, "" until resolved
+    QuantileSketch size;     // bytes, recorded on malloc
+    QuantileSketch lifetime; // microseconds, recorded on free
+} __attribute__((packed));
+
+struct SiteTable {
+    uint32_t magic;          // SITE_SKETCH_MAGIC once initialized
+    uint32_t num_sites;      // SITE_TABLE_SIZE
+    uint32_t sub_bucket_bits;
+    uint32_t num_bins;
+    uint64_t overflow;       // calls dropped because the table was full
+    uint8_t reserved[40];
+    SiteSketches sites[SITE_TABLE_SIZE];
+} __attribute__((packed));
+
+// Live allocations per site by age, as counts and bytes of cohorts keyed
+// by allocation second (since start_ns). Cohorts sit in four levels of
+// growing granularity: 1 s x 12 slots, 10 s x 8, 1 min x 12, 10 min x 8,
+// then one slot for 1 h and older (SiteAges slots 0-11, 12-19, 20-31,
+// 32-39, 40). Each level keeps its last 11/7/11/7 cohorts plus a spare
+// slot; once per second the scanner moves the cohort leaving a level into
+// the next one (epoch_sec is the last second migrated), only once all of
+// it is past the level's age bound (10 s, 1 min, 10 min, 1 h): a level
+// holds ages from the previous bound up to its own plus one cohort. Hooks
+// only add to the current 1 s cohort and subtract from the cohort holding
+// the freed allocation, so no allocation is ever rescanned. Entries are parallel to
+// SiteTable.sites. Counts are signed: a free racing a migration can leave
+// a cohort briefly negative while its site totals stay exact.
+#define SITE_AGE_MAGIC 0x45474153  // "SAGE"
+#define SITE_AGE_LEVELS 4
+#define SITE_AGE_SLOTS 41
+
+struct SiteAges {
+    int64_t count[SITE_AGE_SLOTS];
+    int64_t bytes[SITE_AGE_SLOTS];
+} __attribute__((packed));
+
+struct SiteAgeTable {
+    uint32_t magic;          // SITE_AGE_MAGIC once initialized
+    uint32_t num_sites;      // SITE_TABLE_SIZE
+    uint64_t start_ns;       // CLOCK_MONOTONIC of second 0
+    uint64_t epoch_sec;      // cohorts migrated up to this second
+    uint8_t reserved[40];
+    SiteAges sites[SITE_TABLE_SIZE];
+} __attribute__((packed));
+
+// Top leak suspects: a heavy-hitters summary (weighted Misra-Gries) of the
+// TOPK_SITES sites with the most net live bytes. When a site outside a
+// full summary allocates, min(smallest entry, its bytes) is taken off
+// every entry and off the newcomer, and entries at zero leave; frees of
+// sites outside the summary are dropped. Counts never overstate a site,
+// so churn can't inflate them; a site that keeps growing outpaces the
+// cuts and stays. Sites whose frees bring them to zero leave too. Every
+// window_ns the scanner sets growth_bytes = live_bytes - mark_bytes and
+// marks again, so the worst growers can be read in O(K) at any time. Writers hold lock
+// and bump seq (odd while updating) so readers can copy entries without
+// taking it, as with HeaderSnapshot.
+#define TOPK_MAGIC 0x4b504f54  // "TOPK"
+#define TOPK_SITES 32
+
+struct TopKEntry {
+    uint32_t site_id;
+    uint32_t reserved;
+    int64_t live_bytes;      // net bytes counted for this site
+    int64_t error;           // bytes cut since it entered: live_bytes may understate by this much
+    int64_t mark_bytes;      // live_bytes at the start of the current window
+    int64_t growth_bytes;    // live_bytes change over the last full window
+    uint64_t inserted_ns;    // CLOCK_MONOTONIC when the site entered the summary
+} __attribute__((packed));
+
+struct TopKSites {
+    uint32_t magic;          // TOPK_MAGIC once initialized
+    uint32_t k;              // TOPK_SITES
+    uint32_t lock;           // writers' spinlock
+    uint32_t used;           // entries in use
+    uint64_t seq;            // odd while entries are being changed
+    uint64_t window_ns;
+    uint64_t evictions;
+    uint64_t dropped_bytes;  // bytes freed outside the summary or cut from newcomers
+    uint8_t reserved[16];
+    TopKEntry entries[TOPK_SITES];
+} __attribute__((packed));
+
+// Optional (SITE_RATE_SKETCH=1) count-min sketch of allocations and bytes
+// per site_id, for sites beyond the exact tables. One sketch per time
+// window in a ring of CMS_WINDOWS; the scanner clears the oldest window
+// and makes it current every window_ns, so summing all windows gives a
+// sliding window of (CMS_WINDOWS - 1) to CMS_WINDOWS periods. Row r maps
+// site_id to column ((site_id + 1) * row_seeds[r]) >> (64 - log2(width)).
+// An estimate (minimum over rows of the windows' summed cells) overstates
+// a site by at most epsilon x window total with probability 1 - delta;
+// width = e / epsilon and depth = ln(1 / delta), rounded up and capped at
+// the CMS_MAX_* storage.
+#define CMS_MAGIC 0x4b534d43  // "CMSK"
+#define CMS_MAX_DEPTH 4
+#define CMS_MAX_WIDTH 1024
+#define CMS_WINDOWS 6
+
+struct CountMinSketch {
+    uint32_t magic;          // CMS_MAGIC once initialized
+    uint32_t enabled;
+    uint32_t depth;          // rows in use
+    uint32_t width;          // columns in use (power of two)
+    uint32_t windows;        // CMS_WINDOWS
+    uint32_t current;        // window being written
+    uint64_t window_ns;
+    uint64_t window_start_ns[CMS_WINDOWS];  // CLOCK_MONOTONIC when each window became current
+    double epsilon;
+    double delta;
+    uint64_t row_seeds[CMS_MAX_DEPTH];
+    uint32_t counts[CMS_WINDOWS][CMS_MAX_DEPTH][CMS_MAX_WIDTH];
+    uint64_t bytes[CMS_WINDOWS][CMS_MAX_DEPTH][CMS_MAX_WIDTH];
+} __attribute__((packed));
+
+// Net-growth trend per site, fitted by the scanner every tick_ns from the
+// site's live bytes (the sum of its SiteAges slots, so hooks do no extra
+// work). rate is an EWMA of the per-tick growth in bytes/s and variance
+// the EWMA of its squared deviation; lower = rate - z * sqrt(variance *
+// alpha / (2 - alpha)) bounds the trend from below. A site is flagged once
+// lower has stayed above zero for warmup_ticks ticks in a row and its live
+// bytes exceed those at the start of the run, and unflagged when lower
+// drops back to zero. Only the scanner writes; seq is odd while it does.
+#define SITE_TREND_MAGIC 0x444e5254  // "TRND"
+
+struct SiteTrend {
+    int64_t live_bytes;      // at the last tick
+    int64_t run_start_bytes; // live_bytes when lower last turned positive
+    double rate;             // EWMA growth, bytes/s
+    double variance;         // EWMA variance of the per-tick growth, (bytes/s)^2
+    double lower;            // confidence lower bound of rate
+    uint32_t samples;
+    uint32_t rising_ticks;   // consecutive ticks with lower > 0
+    uint64_t flagged_ns;     // CLOCK_MONOTONIC when flagged, 0 if not
+} __attribute__((packed));
+
+struct SiteTrendTable {
+    uint32_t magic;          // SITE_TREND_MAGIC once initialized
+    uint32_t num_sites;      // SITE_TABLE_SIZE, indexed like SiteTable
+    uint64_t seq;            // odd while the scanner updates
+    uint64_t tick_ns;
+    uint64_t last_tick_ns;
+    double alpha;            // EWMA weight of the newest tick
+    double z;                // confidence bound width, in standard errors
+    uint32_t warmup_ticks;
+    uint32_t flagged_sites;
+    uint8_t reserved[8];
+    SiteTrend sites[SITE_TABLE_SIZE];
+} __attribute__((packed));
+
+// Change-point detection on the live-bytes growth and allocation rate of
+// the process and of every tracked site (indexed like SiteTable): a
+// two-sided CUSUM per series, updated by the scanner every tick_ns.
+// Each tick's rate x is standardized against the series' EWMA baseline
+// (z = (x - mean) / stddev, clipped to +-3), pos = max(0, pos + z - k)
+// and neg = max(0, neg - z - k). The baseline only learns while both
+// sums are zero. When one passes h an alert goes into the alerts ring:
+// the onset estimate is the last tick at which that sum was still zero.
+// The series then relearns its baseline for warmup_ticks before
+// detecting again. Only the scanner writes; seq is odd while it does.
+#define CHANGEPOINT_MAGIC 0x544e5043  // "CPNT"
+#define CHANGEPOINT_ALERTS 64
+
+enum ChangePointSeries {
+    CP_LIVE_BYTES = 0,       // growth of live bytes, bytes/s
+    CP_ALLOC_RATE = 1,       // allocations/s
+    CP_SERIES = 2
+};
+
+struct CusumState {
+    int64_t last_raw;        // counter at the last tick
+    double mean;             // baseline rate
+    double variance;
+    double pos;              // upward CUSUM, in standard deviations
+    double neg;              // downward CUSUM
+    double pos_sum;          // sum of rates since pos left zero
+    double neg_sum;
+    uint32_t pos_ticks;
+    uint32_t neg_ticks;
+    uint64_t pos_start_ns;   // last tick with pos == 0
+    uint64_t neg_start_ns;
+    uint32_t samples;        // rates seen since the baseline (re)started
+    uint32_t alarms;
+    uint64_t last_alarm_ns;
+} __attribute__((packed));
+
+struct ChangeAlert {
+    uint32_t series;         // ChangePointSeries
+    uint32_t site_id;        // CP_PROCESS_SITE for the whole process
+    int32_t direction;       // +1 rate went up, -1 went down
+    uint32_t reserved;
+    uint64_t onset_ns;       // CLOCK_MONOTONIC estimate of the change
+    uint64_t alarm_ns;       // when it was detected
+    double before;           // baseline rate
+    double after;            // mean rate since onset
+} __attribute__((packed));
+
+#define CP_PROCESS_SITE 0xffffffffu
+
+struct ChangePointTable {
+    uint32_t magic;          // CHANGEPOINT_MAGIC once initialized
+    uint32_t num_sites;      // SITE_TABLE_SIZE
+    uint64_t seq;            // odd while the scanner updates
+    uint64_t tick_ns;
+    uint64_t last_tick_ns;
+    double alpha;            // baseline EWMA weight
+    double k;                // CUSUM slack, standard deviations
+    double h;                // CUSUM alarm threshold, standard deviations
+    uint32_t warmup_ticks;
+    uint32_t alerts_written; // alerts[alerts_written % CHANGEPOINT_ALERTS] is next
+    CusumState process[CP_SERIES];
+    CusumState sites[SITE_TABLE_SIZE][CP_SERIES];
+    ChangeAlert alerts[CHANGEPOINT_ALERTS];
+} __attribute__((packed));
+
+#define LEAK_BUFFER_SIZE 1000
+struct LeakDetectionBuffer {
+    volatile int write_index;
+    volatile int read_index;
+    volatile uint64_t total_allocations;
+    volatile uint64_t total_frees;
+    volatile uint64_t current_memory;
+    volatile uint32_t leak_count;
+    LeakEvent events[LEAK_BUFFER_SIZE];
+    uint32_t reserved0;      // keeps stats 8-byte aligned for atomic adds
+    AgentStats stats;
+    AllocatorProfile alloc_profile;
+    uint8_t reserved1[SHM_PAD_TO_64(36 + sizeof(LeakEvent) * LEAK_BUFFER_SIZE + 4 + sizeof(AgentStats) +
+                                    sizeof(AllocatorProfile))];
+    CpuCounters cpu_counters;
+    HeaderSnapshot snapshot;
+    SizeHistograms size_hist;
+    SiteTable sites;
+    SiteAgeTable site_ages;
+    TopKSites top_sites;
+    CountMinSketch site_rates;
+    SiteTrendTable site_trends;
+    ChangePointTable change_points;
+} __attribute__((packed));
+
+static_assert(offsetof(SharedBuffer, cpu_counters) % 64 == 0, "per-CPU slots must be cache-line aligned");
+static_assert(offsetof(LeakDetectionBuffer, cpu_counters) % 64 == 0, "per-CPU slots must be cache-line aligned");
+static_assert(offsetof(LeakDetectionBuffer, snapshot) % 64 == 0, "snapshot must sit on its own cache line");
+static_assert(offsetof(LeakDetectionBuffer, size_hist) % 64 == 0, "size histogram slots must be cache-line aligned");
+static_assert(offsetof(LeakDetectionBuffer, sites) % 8 == 0, "site table must be 8-byte aligned for atomic adds");
+static_assert(offsetof(LeakDetectionBuffer, site_ages) % 8 == 0, "site ages must be 8-byte aligned for atomic adds");
+static_assert(offsetof(LeakDetectionBuffer, top_sites) % 8 == 0, "top-K summary must be 8-byte aligned for atomic ops");
+static_assert(offsetof(LeakDetectionBuffer, site_rates) % 8 == 0, "count-min cells must be 8-byte aligned for atomic adds");
+static_assert(offsetof(LeakDetectionBuffer, site_trends) % 8 == 0, "site trends must be 8-byte aligned");
+static_assert(offsetof(LeakDetectionBuffer, change_points) % 8 == 0, "change points must be 8-byte aligned");
@@ -10,6 +10,8 @@ import os
 import sys
 import signal
 
+from agent_stats import read_header_snapshot
+
 class SimpleAdvancedAnalyzer:
     def __init__(self):
         self.shm_fd = None
@@ -43,6 +45,11 @@ class SimpleAdvancedAnalyzer:
                 return False
         return False
     
+    def read_snapshot(self):
+        """(total_allocs, total_frees, current_mem, leak_count) from the seqlock snapshot, or None"""
+        snapshot = read_header_snapshot(self.shm)
+        return snapshot[1:5] if snapshot else None
+    
     def read_stats(self):
         """Read buffer statistics"""
         if not self.shm:
@@ -56,6 +63,11 @@ class SimpleAdvancedAnalyzer:
                 write_index, read_index, total_allocs, total_frees, current_mem, leak_count = \
                     self.header_struct.unpack(header_data)
                 
+                # Prefer the snapshot: the raw header fields can be read mid-update
+                snapshot = self.read_snapshot()
+                if snapshot:
+                    total_allocs, total_frees, current_mem, leak_count = snapshot
+                
                 return {
                     'write_index': write_index,
                     'read_index': read_index,
@@ -0,0 +1,97 @@
+#pragma once
+
+// Live allocations per site by age (see SiteAgeTable in shm_layout.h).
+//
+// A timing wheel per site: malloc adds to the cohort of the current
+// second, free subtracts from whichever cohort now holds the allocation's
+// second, and the scanner thread ages every site once per second by
+// moving the cohort that falls out of each level into the next. Hooks do
+// two relaxed atomic adds; nothing walks live allocations. Reader:
+// agent_stats.py --ages.
+
+#include <cstdint>
+#include "shm_layout.h"
+#include "site_sketch.h"
+
+// Per level: cohort length in seconds, cohorts kept, first slot
+static const uint64_t site_age_granularity[SITE_AGE_LEVELS] = {1, 10, 60, 600};
+static const uint64_t site_age_span[SITE_AGE_LEVELS] = {11, 7, 11, 7};
+static const int site_age_base[SITE_AGE_LEVELS] = {0, 12, 20, 32};
+#define SITE_AGE_OLD_SLOT (SITE_AGE_SLOTS - 1)
+
+static SiteAgeTable* site_age_table = nullptr;
+
+// Slot holding allocations made in second alloc_sec, as of epoch
+static inline int site_age_slot(uint64_t alloc_sec, uint64_t epoch) {
+    for (int k = 0; k < SITE_AGE_LEVELS; k++) {
+        uint64_t g = site_age_granularity[k];
+        uint64_t cohort = alloc_sec / g;
+        if (cohort + site_age_span[k] > epoch / g) {
+            return site_age_base[k] + (int)(cohort % (site_age_span[k] + 1));
+        }
+    }
+    return SITE_AGE_OLD_SLOT;
+}
+
+static inline void site_age_add(SiteSketches* entry, uint64_t alloc_ns, int64_t count, int64_t bytes) {
+    SiteAgeTable* table = site_age_table;
+    SiteTable* sites = site_table;
+    if (!table || !sites || !entry || alloc_ns < table->start_ns) return;
+    uint64_t epoch = __atomic_load_n(&table->epoch_sec, __ATOMIC_ACQUIRE);
+    int slot = site_age_slot((alloc_ns - table->start_ns) / 1000000000ULL, epoch);
+    char* base = (char*)&table->sites[entry - sites->sites];
+    __atomic_fetch_add((int64_t*)(base + offsetof(SiteAges, count)) + slot, count, __ATOMIC_RELAXED);
+    __atomic_fetch_add((int64_t*)(base + offsetof(SiteAges, bytes)) + slot, bytes, __ATOMIC_RELAXED);
+}
+
+static inline void site_age_malloc(SiteSketches* entry, uint64_t alloc_ns, size_t size) {
+    site_age_add(entry, alloc_ns, 1, (int64_t)size);
+}
+
+static inline void site_age_free(SiteSketches* entry, uint64_t alloc_ns, size_t size) {
+    site_age_add(entry, alloc_ns, -1, -(int64_t)size);
+}
+
+static inline void site_age_move(SiteAges& ages, int from, int to) {
+    char* base = (char*)&ages;
+    int64_t* count = (int64_t*)(base + offsetof(SiteAges, count));
+    int64_t* bytes = (int64_t*)(base + offsetof(SiteAges, bytes));
+    int64_t n = __atomic_exchange_n(&count[from], 0, __ATOMIC_RELAXED);
+    int64_t b = __atomic_exchange_n(&bytes[from], 0, __ATOMIC_RELAXED);
+    if (n) __atomic_fetch_add(&count[to], n, __ATOMIC_RELAXED);
+    if (b) __atomic_fetch_add(&bytes[to], b, __ATOMIC_RELAXED);
+}
+
+// Scanner thread: age every site up to now, one second at a time
+static void site_age_advance(uint64_t now_ns) {
+    SiteAgeTable* table = site_age_table;
+    SiteTable* sites = site_table;
+    if (!table || !sites || now_ns < table->start_ns) return;
+    uint64_t now_sec = (now_ns - table->start_ns) / 1000000000ULL;
+    for (uint64_t epoch = table->epoch_sec + 1; epoch <= now_sec; epoch++) {
+        for (int k = 0; k < SITE_AGE_LEVELS; k++) {
+            uint64_t g = site_age_granularity[k];
+            if (epoch % g || epoch / g < site_age_span[k]) continue;
+            // The cohort leaving level k, and where it goes
+            uint64_t cohort = epoch / g - site_age_span[k];
+            int from = site_age_base[k] + (int)(cohort % (site_age_span[k] + 1));
+            int to = SITE_AGE_OLD_SLOT;
+            if (k + 1 < SITE_AGE_LEVELS) {
+                uint64_t next = cohort * g / site_age_granularity[k + 1];
+                to = site_age_base[k + 1] + (int)(next % (site_age_span[k + 1] + 1));
+            }
+            for (int i = 0; i < SITE_TABLE_SIZE; i++) {
+                if (__atomic_load_n(&sites->sites[i].key, __ATOMIC_ACQUIRE)) site_age_move(table->sites[i], from, to);
+            }
+        }
+        __atomic_store_n(&table->epoch_sec, epoch, __ATOMIC_RELEASE);
+    }
+}
+
+// area: zeroed SiteAgeTable in shm
+static inline void site_age_init(SiteAgeTable* area, uint64_t start_ns) {
+    area->num_sites = SITE_TABLE_SIZE;
+    area->start_ns = start_ns;
+    __atomic_store_n(&area->magic, SITE_AGE_MAGIC, __ATOMIC_RELEASE);
+    site_age_table = area;
+}
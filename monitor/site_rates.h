@@ -0,0 +1,92 @@
+#pragma once
+
+// Count-min sketch of per-site allocation rates (see CountMinSketch in
+// shm_layout.h).
+//
+// Off by default: the exact per-site tables cover most programs, and
+// this costs depth x 2 relaxed atomic adds per malloc. It bounds memory
+// when distinct sites outgrow those tables. Only allocations are
+// counted; frees don't change a rate. Reader: agent_stats.py --rates.
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cstdint>
+#include "shm_layout.h"
+
+#define CMS_DEFAULT_EPSILON 0.005
+#define CMS_DEFAULT_DELTA 0.02
+#define CMS_DEFAULT_WINDOW_NS 10000000000ULL
+
+static CountMinSketch* site_rates = nullptr;
+static volatile int site_rates_enabled = 0;
+static int site_rates_shift = 64;  // 64 - log2(width)
+
+// Odd multipliers for multiply-shift hashing, one per row
+static const uint64_t cms_seeds[CMS_MAX_DEPTH] = {
+    0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL, 0xd6e8feb86659fd93ULL};
+
+static inline void site_rates_record(uint32_t site_id, size_t size) {
+    CountMinSketch* cms = site_rates;
+    if (!site_rates_enabled || !cms) return;
+    uint32_t window = __atomic_load_n(&cms->current, __ATOMIC_ACQUIRE);
+    char* base = (char*)cms;
+    uint32_t* counts = (uint32_t*)(base + offsetof(CountMinSketch, counts)) + window * CMS_MAX_DEPTH * CMS_MAX_WIDTH;
+    uint64_t* bytes = (uint64_t*)(base + offsetof(CountMinSketch, bytes)) + window * CMS_MAX_DEPTH * CMS_MAX_WIDTH;
+    uint64_t key = (uint64_t)site_id + 1;
+    for (uint32_t r = 0; r < cms->depth; r++) {
+        uint32_t col = (uint32_t)((key * cms_seeds[r]) >> site_rates_shift);
+        __atomic_fetch_add(&counts[r * CMS_MAX_WIDTH + col], 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&bytes[r * CMS_MAX_WIDTH + col], (uint64_t)size, __ATOMIC_RELAXED);
+    }
+}
+
+// Scanner thread: clear the oldest window and make it current once
+// window_ns has passed
+static void site_rates_tick(uint64_t now_ns) {
+    CountMinSketch* cms = site_rates;
+    if (!cms || !site_rates_enabled) return;
+    uint32_t current = cms->current;
+    if (now_ns - cms->window_start_ns[current] < cms->window_ns) return;
+    uint32_t next = (current + 1) % CMS_WINDOWS;
+    memset((char*)cms + offsetof(CountMinSketch, counts) + next * sizeof(cms->counts[0]), 0, sizeof(cms->counts[0]));
+    memset((char*)cms + offsetof(CountMinSketch, bytes) + next * sizeof(cms->bytes[0]), 0, sizeof(cms->bytes[0]));
+    cms->window_start_ns[next] = now_ns;
+    __atomic_store_n(&cms->current, next, __ATOMIC_RELEASE);
+}
+
+// Sizes the sketch for the requested error: width e/epsilon (rounded up to
+// a power of two), depth ln(1/delta), both capped by the shm storage
+static void site_rates_configure(CountMinSketch* cms, double epsilon, double delta) {
+    if (epsilon <= 0) epsilon = CMS_DEFAULT_EPSILON;
+    if (delta <= 0 || delta >= 1) delta = CMS_DEFAULT_DELTA;
+    uint32_t width = 2;
+    int bits = 1;
+    while (width < M_E / epsilon && width < CMS_MAX_WIDTH) {
+        width <<= 1;
+        bits++;
+    }
+    uint32_t depth = (uint32_t)ceil(log(1 / delta));
+    if (depth < 1) depth = 1;
+    if (depth > CMS_MAX_DEPTH) depth = CMS_MAX_DEPTH;
+    cms->width = width;
+    cms->depth = depth;
+    cms->epsilon = M_E / width;
+    cms->delta = exp(-(double)depth);
+    site_rates_shift = 64 - bits;
+}
+
+// area: zeroed CountMinSketch in shm
+static inline void site_rates_init(CountMinSketch* area, uint64_t now_ns) {
+    area->windows = CMS_WINDOWS;
+    area->window_ns = CMS_DEFAULT_WINDOW_NS;
+    if (const char* env = getenv("SITE_RATE_WINDOW_MS")) {
+        uint64_t ms = strtoull(env, nullptr, 10);
+        if (ms) area->window_ns = ms * 1000000ULL;
+    }
+    for (int r = 0; r < CMS_MAX_DEPTH; r++) area->row_seeds[r] = cms_seeds[r];
+    site_rates_configure(area, CMS_DEFAULT_EPSILON, CMS_DEFAULT_DELTA);
+    area->window_start_ns[0] = now_ns;
+    __atomic_store_n(&area->magic, CMS_MAGIC, __ATOMIC_RELEASE);
+    site_rates = area;
+}
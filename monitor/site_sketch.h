@@ -0,0 +1,103 @@
+#pragma once
+
+// Per-site size and lifetime sketches (see SiteTable in shm_layout.h).
+//
+// Sites are found by open addressing on site_id, like the allocator
+// profile's outlier table; bins are shared by every thread allocating
+// from the site, so updates are relaxed atomic adds. Resolving the
+// caller to module+offset needs dladdr, which can take loader locks, so
+// it is left to the scanner thread (site_sketch_resolve) rather than the
+// hooks. Reader: agent_stats.py --sites; merging: sketch_merge.py.
+
+#include <dlfcn.h>
+#include <string.h>
+#include <cstdint>
+#include "shm_layout.h"
+#include "size_histogram.h"
+
+#define SITE_SKETCH_PROBES 16
+
+static SiteTable* site_table = nullptr;
+
+// Entry for site_id, claimed if new (caller is recorded on claim); nullptr
+// when the probe sequence is full or lookup_only and the site is unknown
+static inline SiteSketches* site_sketch_entry(uint32_t site_id, uintptr_t caller, bool lookup_only) {
+    SiteTable* table = site_table;
+    if (!table) return nullptr;
+    uint32_t key = site_id + 1;
+    for (uint32_t probe = 0; probe < SITE_SKETCH_PROBES; probe++) {
+        SiteSketches& entry = table->sites[(key * 2654435761u + probe) % SITE_TABLE_SIZE];
+        uint32_t current = __atomic_load_n(&entry.key, __ATOMIC_ACQUIRE);
+        if (current == key) return &entry;
+        if (current != 0) continue;
+        if (lookup_only) return nullptr;
+        uint32_t expected = 0;
+        if (__atomic_compare_exchange_n(&entry.key, &expected, key, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            entry.site_id = site_id;
+            __atomic_store_n(&entry.caller, (uint64_t)caller, __ATOMIC_RELEASE);
+            return &entry;
+        }
+        if (expected == key) return &entry;
+    }
+    __atomic_fetch_add(&table->overflow, 1, __ATOMIC_RELAXED);
+    return nullptr;
+}
+
+static inline void sketch_add(QuantileSketch& sketch, uint64_t value) {
+    int bin = log_linear_bucket(value, SITE_SKETCH_SUB_BITS, SITE_SKETCH_BINS);
+    char* base = (char*)&sketch;  // 8-byte aligned in the table; avoids packed-member warnings
+    uint32_t* bins = (uint32_t*)(base + offsetof(QuantileSketch, bins));
+    uint64_t* count = (uint64_t*)(base + offsetof(QuantileSketch, count));
+    uint64_t* sum = (uint64_t*)(base + offsetof(QuantileSketch, sum));
+    __atomic_fetch_add(&bins[bin], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(sum, value, __ATOMIC_RELAXED);
+}
+
+// Both return the site's entry (nullptr if untracked) for the other per-site tables
+static inline SiteSketches* site_sketch_malloc(uint32_t site_id, uintptr_t caller, size_t size) {
+    SiteSketches* entry = site_sketch_entry(site_id, caller, false);
+    if (entry) sketch_add(entry->size, size);
+    return entry;
+}
+
+static inline SiteSketches* site_sketch_free(uint32_t site_id, uint64_t lifetime_ns) {
+    SiteSketches* entry = site_sketch_entry(site_id, 0, true);
+    if (entry) sketch_add(entry->lifetime, lifetime_ns / 1000);
+    return entry;
+}
+
+// Scanner thread: name the module of sites claimed since the last call
+static void site_sketch_resolve() {
+    SiteTable* table = site_table;
+    if (!table) return;
+    for (int i = 0; i < SITE_TABLE_SIZE; i++) {
+        SiteSketches& entry = table->sites[i];
+        uint64_t caller = __atomic_load_n(&entry.caller, __ATOMIC_ACQUIRE);
+        if (!caller || entry.module[0]) continue;
+        Dl_info info;
+        const char* name = "?";
+        uint64_t offset = caller;
+        if (dladdr((void*)caller, &info) && info.dli_fname) {
+            name = strrchr(info.dli_fname, '/') ? strrchr(info.dli_fname, '/') + 1 : info.dli_fname;
+            if (!*name) name = "main";
+            offset = caller - (uint64_t)info.dli_fbase;
+        }
+        entry.module_offset = offset;
+        char module[SITE_MODULE_NAME];
+        strncpy(module, name, sizeof(module) - 1);
+        module[sizeof(module) - 1] = '\0';
+        // First byte last: readers treat a non-empty name as resolved
+        memcpy(entry.module + 1, module + 1, sizeof(module) - 1);
+        __atomic_store_n(&entry.module[0], module[0], __ATOMIC_RELEASE);
+    }
+}
+
+// area: zeroed SiteTable in shm
+static inline void site_sketch_init(SiteTable* area) {
+    area->num_sites = SITE_TABLE_SIZE;
+    area->sub_bucket_bits = SITE_SKETCH_SUB_BITS;
+    area->num_bins = SITE_SKETCH_BINS;
+    __atomic_store_n(&area->magic, SITE_SKETCH_MAGIC, __ATOMIC_RELEASE);
+    site_table = area;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+// Net-growth trend detector per site (see SiteTrendTable in shm_layout.h).
+//
+// Unlike the staleness scan it never looks at individual allocations:
+// once per tick the scanner thread reads each site's live bytes from the
+// age wheel and folds the growth since the last tick into an EWMA of the
+// rate and of its variance, O(1) per site. Churn averages out to a rate
+// near zero with a wide bound; steady growth, even under churn, pushes
+// the lower bound above zero and keeps it there. Reader:
+// agent_stats.py --trend.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <cstdint>
+#include "shm_layout.h"
+#include "site_sketch.h"
+#include "site_ages.h"
+
+#define SITE_TREND_DEFAULT_TICK_NS 1000000000ULL
+#define SITE_TREND_DEFAULT_ALPHA 0.1
+#define SITE_TREND_DEFAULT_Z 3.0
+
+static SiteTrendTable* site_trends = nullptr;
+
+static inline int64_t site_live_bytes(const SiteAges& ages) {
+    const char* base = (const char*)&ages;
+    const int64_t* bytes = (const int64_t*)(base + offsetof(SiteAges, bytes));
+    int64_t live = 0;
+    for (int slot = 0; slot < SITE_AGE_SLOTS; slot++) live += __atomic_load_n(&bytes[slot], __ATOMIC_RELAXED);
+    return live;
+}
+
+// One tick of one site: dt in seconds since the last tick
+static void site_trend_update(SiteTrendTable* table, SiteTrend& trend, int64_t live, double dt, uint64_t now_ns) {
+    if (trend.samples++ == 0) {
+        trend.live_bytes = live;
+        return;
+    }
+    double alpha = table->alpha;
+    double growth = (double)(live - trend.live_bytes) / dt;
+    double deviation = growth - trend.rate;
+    trend.live_bytes = live;
+    trend.rate += alpha * deviation;
+    trend.variance = (1 - alpha) * (trend.variance + alpha * deviation * deviation);
+    trend.lower = trend.rate - table->z * sqrt(trend.variance * alpha / (2 - alpha));
+
+    if (trend.lower <= 0) {
+        trend.rising_ticks = 0;
+        if (trend.flagged_ns) table->flagged_sites--;
+        trend.flagged_ns = 0;
+        return;
+    }
+    if (trend.rising_ticks++ == 0) trend.run_start_bytes = live;
+    if (!trend.flagged_ns && trend.rising_ticks >= table->warmup_ticks && live > trend.run_start_bytes &&
+        trend.samples > table->warmup_ticks) {
+        trend.flagged_ns = now_ns;
+        table->flagged_sites++;
+        printf("[TREND] 🔥 Site %u growing %.0f bytes/s (>= %.0f), %ld bytes live\n",
+               site_table->sites[&trend - table->sites].site_id, trend.rate, trend.lower, (long)live);
+    }
+}
+
+// Scanner thread, after site_age_advance: fit every site once tick_ns has passed
+static void site_trend_tick(uint64_t now_ns) {
+    SiteTrendTable* table = site_trends;
+    SiteAgeTable* ages = site_age_table;
+    SiteTable* sites = site_table;
+    if (!table || !ages || !sites) return;
+    if (now_ns - table->last_tick_ns < table->tick_ns) return;
+    double dt = (now_ns - table->last_tick_ns) / 1e9;
+    table->last_tick_ns = now_ns;
+
+    uint64_t seq = table->seq;
+    __atomic_store_n(&table->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (int i = 0; i < SITE_TABLE_SIZE; i++) {
+        if (!__atomic_load_n(&sites->sites[i].key, __ATOMIC_ACQUIRE)) continue;
+        site_trend_update(table, table->sites[i], site_live_bytes(ages->sites[i]), dt, now_ns);
+    }
+    __atomic_store_n(&table->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// area: zeroed SiteTrendTable in shm
+static inline void site_trend_init(SiteTrendTable* area, uint64_t now_ns) {
+    area->num_sites = SITE_TABLE_SIZE;
+    area->tick_ns = SITE_TREND_DEFAULT_TICK_NS;
+    area->alpha = SITE_TREND_DEFAULT_ALPHA;
+    area->z = SITE_TREND_DEFAULT_Z;
+    if (const char* env = getenv("SITE_TREND_TICK_MS")) {
+        uint64_t ms = strtoull(env, nullptr, 10);
+        if (ms) area->tick_ns = ms * 1000000ULL;
+    }
+    if (const char* env = getenv("SITE_TREND_ALPHA")) {
+        double alpha = atof(env);
+        if (alpha > 0 && alpha < 1) area->alpha = alpha;
+    }
+    if (const char* env = getenv("SITE_TREND_Z")) {
+        double z = atof(env);
+        if (z > 0) area->z = z;
+    }
+    // An EWMA needs about 1 / alpha samples before it means anything
+    area->warmup_ticks = (uint32_t)ceil(1 / area->alpha);
+    area->last_tick_ns = now_ns;
+    __atomic_store_n(&area->magic, SITE_TREND_MAGIC, __ATOMIC_RELEASE);
+    site_trends = area;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// Allocation/free size histograms (see SizeHistograms in shm_layout.h).
+//
+// A thread claims a slot on its first recorded call and is its only
+// writer, so an update is a plain load and store on a cache line no other
+// thread writes. Slots are not reused when threads exit: their counts
+// stay part of the totals. Threads past SIZE_HIST_THREAD_SLOTS share the
+// last slot with atomic adds. Reader: agent_stats.py --sizes.
+
+#include <cstdint>
+#include "shm_layout.h"
+
+static SizeHistograms* size_histograms = nullptr;
+static __thread int size_hist_thread_slot __attribute__((tls_model("initial-exec"))) = -1;
+
+// Log-linear bucket: 2^sub_bits linear steps per power of two, values
+// below 2^sub_bits get a bucket each, the last bucket is open-ended
+static inline int log_linear_bucket(uint64_t value, int sub_bits, int buckets) {
+    if (value < (1u << sub_bits)) return (int)value;
+    int e = 63 - __builtin_clzll(value);
+    int sub = (int)(value >> (e - sub_bits)) & ((1 << sub_bits) - 1);
+    int b = (1 << sub_bits) + ((e - sub_bits) << sub_bits) + sub;
+    return b < buckets ? b : buckets - 1;
+}
+
+static inline int size_hist_bucket(uint64_t size) {
+    return log_linear_bucket(size, SIZE_HIST_SUB_BITS, SIZE_HIST_BUCKETS);
+}
+
+static inline void size_hist_record(int op, uint64_t size) {
+    SizeHistograms* hist = size_histograms;
+    if (!hist) return;
+
+    int slot = size_hist_thread_slot;
+    if (slot < 0) {
+        slot = (int)__atomic_fetch_add(&hist->slots_claimed, 1, __ATOMIC_RELAXED);
+        if (slot >= SIZE_HIST_THREAD_SLOTS) slot = SIZE_HIST_THREAD_SLOTS;
+        size_hist_thread_slot = slot;
+    }
+    uint64_t* count = (uint64_t*)((char*)hist->slots[slot].counts +
+                                  (op * SIZE_HIST_BUCKETS + size_hist_bucket(size)) * sizeof(uint64_t));
+    if (slot < SIZE_HIST_THREAD_SLOTS) {
+        __atomic_store_n(count, __atomic_load_n(count, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(count, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// area: zeroed SizeHistograms in shm
+static inline void size_hist_init(SizeHistograms* area) {
+    area->num_slots = SIZE_HIST_SLOTS;
+    area->sub_bucket_bits = SIZE_HIST_SUB_BITS;
+    area->num_buckets = SIZE_HIST_BUCKETS;
+    __atomic_store_n(&area->magic, SIZE_HIST_MAGIC, __ATOMIC_RELEASE);
+    size_histograms = area;
+}
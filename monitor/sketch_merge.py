@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""
+Per-site sketch merge
+=====================
+
+Adds up the per-site size and lifetime sketches from several
+`agent_stats.py --sites --json` dumps (other processes, other hosts) and
+prints fleet-wide quantiles per site. Sketch bins share one fixed
+mapping, so merging is a bin-by-bin sum and the result is as accurate as
+any single sketch.
+
+Sites are matched by module basename + offset, which stays the same
+across processes running the same binary. Sites whose module was not
+resolved yet are skipped (and counted): their site_id hashes an ASLR'd
+address, so equal ids in different dumps are unrelated sites. --out
+writes the merged sketches in the same format, so merges can be chained
+(per host, then fleet).
+
+Usage: sketch_merge.py DUMP.json [DUMP.json ...] [--out MERGED.json] [--top N]
+"""
+
+import argparse
+import json
+import sys
+
+from agent_stats import format_us, sketch_quantile
+
+
+def load_dump(path):
+    """Returns (sub_bucket_bits, sites) from one dump"""
+    with open(path) as f:
+        report = json.load(f)
+    sketches = report.get('site_sketches', report)
+    return sketches['sub_bucket_bits'], sketches['sites']
+
+
+def site_key(site):
+    """(module, offset), or None while the site is unresolved"""
+    if site.get('module'):
+        return site['module'], site['module_offset']
+    return None
+
+
+def merge_sketch(into, sketch):
+    into['count'] += sketch['count']
+    into['sum'] += sketch['sum']
+    for b, n in sketch['bins'].items():
+        into['bins'][int(b)] = into['bins'].get(int(b), 0) + n
+
+
+def merge(dumps):
+    """Merges [(sub_bits, sites)] into (sub_bits, merged sites, sources per site, unresolved sites skipped)"""
+    sub_bits = dumps[0][0]
+    merged = {}
+    sources = {}
+    unresolved = 0
+    for bits, sites in dumps:
+        if bits != sub_bits:
+            raise ValueError(f"sketch mappings differ ({bits} vs {sub_bits} sub-bucket bits)")
+        for site in sites:
+            key = site_key(site)
+            if key is None:
+                unresolved += 1
+                continue
+            if key not in merged:
+                merged[key] = {'site_id': site['site_id'], 'module': site.get('module', ''),
+                               'module_offset': site.get('module_offset', 0),
+                               'size': {'count': 0, 'sum': 0, 'bins': {}},
+                               'lifetime_us': {'count': 0, 'sum': 0, 'bins': {}}}
+                sources[key] = 0
+            merge_sketch(merged[key]['size'], site['size'])
+            merge_sketch(merged[key]['lifetime_us'], site['lifetime_us'])
+            sources[key] += 1
+    return sub_bits, merged, sources, unresolved
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Merge per-site sketches from several agents')
+    parser.add_argument('dumps', nargs='+', help='agent_stats.py --sites --json output files')
+    parser.add_argument('--out', help='write the merged sketches here')
+    parser.add_argument('--top', type=int, default=30, help='sites to print')
+    args = parser.parse_args()
+
+    try:
+        sub_bits, merged, sources, unresolved = merge([load_dump(path) for path in args.dumps])
+    except (OSError, KeyError, ValueError) as e:
+        print(f"❌ {e}")
+        return 1
+
+    print(f"📍 {len(merged)} sites merged from {len(args.dumps)} dumps"
+          f"{f', {unresolved} unresolved sites skipped' if unresolved else ''}")
+    print(f"{'module+offset':<32} {'dumps':>5} {'allocs':>10} {'size p50':>9} {'p99':>9} "
+          f"{'frees':>10} {'life p50':>10} {'p99':>10}")
+    ranked = sorted(merged.items(), key=lambda item: item[1]['size']['count'], reverse=True)
+    for key, site in ranked[:args.top]:
+        where = f"{site['module']}+{site['module_offset']:#x}"
+        size, life = site['size'], site['lifetime_us']
+        print(f"{where[:32]:<32} {sources[key]:>5} {size['count']:>10} "
+              f"{sketch_quantile(size, 0.5, sub_bits):>9.0f} {sketch_quantile(size, 0.99, sub_bits):>9.0f} "
+              f"{life['count']:>10} {format_us(sketch_quantile(life, 0.5, sub_bits)):>10} "
+              f"{format_us(sketch_quantile(life, 0.99, sub_bits)):>10}")
+
+    if args.out:
+        with open(args.out, 'w') as f:
+            json.dump({'site_sketches': {'sub_bucket_bits': sub_bits, 'overflow': 0,
+                                         'sites': list(merged.values())}}, f)
+        print(f"💾 Merged sketches written to {args.out}")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,247 @@
+#pragma once
+
+// Heavy-hitters top-K of sites by net live bytes (see TopKSites in
+// shm_layout.h).
+//
+// Hooks add each call's byte delta to a thread-local batch netted per
+// site, and fold the batch into the shared summary once per scanner
+// epoch, so churn cancels out before it competes with real growth. A
+// hook never waits for the spinlock: if it is held, the deltas go into
+// a lock-free per-site_id table that the scanner folds on its next tick.
+// A thread's pending batch is folded when it exits (pthread key
+// destructor). The scanner closes a growth window every window_ns.
+// Reader: agent_stats.py --top.
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <cstdint>
+#include "shm_layout.h"
+#include "agent_stats.h"
+
+#define TOPK_PENDING 256         // direct-mapped by site_id
+#define TOPK_EPOCH_NS 100000000ULL
+#define TOPK_DEFAULT_WINDOW_NS 10000000000ULL
+#define TOPK_SITE_IDS 65536      // site_id is a 16-bit hash of the call site
+
+struct TopKPending {
+    uint32_t site_id;        // 0 = empty, else site_id + 1
+    int64_t bytes;
+};
+
+static TopKSites* top_sites = nullptr;
+// Bumped by the scanner every TOPK_EPOCH_NS: threads fold their batch on their next call
+static volatile uint32_t topk_epoch = 0;
+static __thread TopKPending topk_pending[TOPK_PENDING] __attribute__((tls_model("initial-exec")));
+static __thread uint32_t topk_pending_count __attribute__((tls_model("initial-exec")));
+static __thread uint32_t topk_local_epoch __attribute__((tls_model("initial-exec")));
+static __thread bool topk_thread_registered __attribute__((tls_model("initial-exec")));
+static pthread_key_t topk_thread_key;
+
+// Deltas hooks couldn't fold because the lock was held: added atomically
+// per site_id, with a dirty bit per site set after the add so the
+// scanner only visits sites that changed. Process-local, not in shm.
+static int64_t topk_deferred[TOPK_SITE_IDS];
+static uint64_t topk_deferred_dirty[TOPK_SITE_IDS / 64];
+
+static inline void topk_lock(TopKSites* topk) {
+    while (__atomic_exchange_n(&topk->lock, 1, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&topk->lock, __ATOMIC_RELAXED)) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+    }
+    __atomic_store_n(&topk->seq, topk->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline bool topk_try_lock(TopKSites* topk) {
+    if (__atomic_load_n(&topk->lock, __ATOMIC_RELAXED) || __atomic_exchange_n(&topk->lock, 1, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    __atomic_store_n(&topk->seq, topk->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return true;
+}
+
+static inline void topk_unlock(TopKSites* topk) {
+    __atomic_store_n(&topk->seq, topk->seq + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&topk->lock, 0, __ATOMIC_RELEASE);
+}
+
+static inline void topk_remove(TopKSites* topk, uint32_t i) {
+    topk->entries[i] = topk->entries[--topk->used];
+}
+
+// Caller holds the lock
+static void topk_apply(TopKSites* topk, uint32_t site_id, int64_t bytes, uint64_t now_ns) {
+    for (uint32_t i = 0; i < topk->used; i++) {
+        if (topk->entries[i].site_id == site_id) {
+            topk->entries[i].live_bytes += bytes;
+            if (topk->entries[i].live_bytes <= 0) topk_remove(topk, i);
+            return;
+        }
+    }
+    if (bytes <= 0) {
+        topk->dropped_bytes += (uint64_t)-bytes;
+        return;
+    }
+
+    if (topk->used == TOPK_SITES) {
+        // Full: take min(smallest entry, bytes) off every entry and off the
+        // newcomer, dropping entries that reach zero
+        int64_t cut = bytes;
+        for (uint32_t i = 0; i < topk->used; i++) {
+            if (topk->entries[i].live_bytes < cut) cut = topk->entries[i].live_bytes;
+        }
+        for (uint32_t i = 0; i < topk->used;) {
+            TopKEntry& entry = topk->entries[i];
+            entry.live_bytes -= cut;
+            entry.mark_bytes -= cut;
+            entry.error += cut;
+            if (entry.live_bytes <= 0) {
+                topk_remove(topk, i);
+                topk->evictions++;
+            } else {
+                i++;
+            }
+        }
+        topk->dropped_bytes += (uint64_t)cut;
+        bytes -= cut;
+        if (bytes <= 0) return;
+    }
+
+    TopKEntry& entry = topk->entries[topk->used++];
+    entry.site_id = site_id;
+    entry.live_bytes = bytes;
+    entry.error = 0;
+    entry.mark_bytes = 0;
+    entry.growth_bytes = 0;
+    entry.inserted_ns = now_ns;
+}
+
+static inline void topk_defer(uint32_t site_id, int64_t bytes) {
+    site_id %= TOPK_SITE_IDS;
+    __atomic_fetch_add(&topk_deferred[site_id], bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_or(&topk_deferred_dirty[site_id / 64], 1ULL << (site_id % 64), __ATOMIC_RELEASE);
+}
+
+// wait = false (hooks): hand the deltas to the scanner if the lock is held
+static void topk_fold(TopKSites* topk, TopKPending* pending, uint32_t count, bool wait) {
+    if (wait) {
+        topk_lock(topk);
+    } else if (!topk_try_lock(topk)) {
+        for (uint32_t i = 0; i < count; i++) {
+            if (pending[i].bytes) topk_defer(pending[i].site_id - 1, pending[i].bytes);
+        }
+        return;
+    }
+    uint64_t now = agent_monotonic_ns();
+    for (uint32_t i = 0; i < count; i++) {
+        if (pending[i].bytes) topk_apply(topk, pending[i].site_id - 1, pending[i].bytes, now);
+    }
+    topk_unlock(topk);
+}
+
+// Scanner (and shutdown): fold the deltas hooks deferred
+static void topk_drain_deferred(TopKSites* topk) {
+    uint64_t now = agent_monotonic_ns();
+    bool locked = false;
+    for (uint32_t w = 0; w < TOPK_SITE_IDS / 64; w++) {
+        if (!__atomic_load_n(&topk_deferred_dirty[w], __ATOMIC_RELAXED)) continue;
+        // A delta added after this exchange sets its bit again
+        uint64_t dirty = __atomic_exchange_n(&topk_deferred_dirty[w], 0, __ATOMIC_ACQUIRE);
+        while (dirty) {
+            uint32_t site_id = w * 64 + __builtin_ctzll(dirty);
+            dirty &= dirty - 1;
+            int64_t bytes = __atomic_exchange_n(&topk_deferred[site_id], 0, __ATOMIC_RELAXED);
+            if (!bytes) continue;
+            if (!locked) {
+                topk_lock(topk);
+                locked = true;
+            }
+            topk_apply(topk, site_id, bytes, now);
+        }
+    }
+    if (locked) topk_unlock(topk);
+}
+
+// Folds this thread's batch into the summary; wait as for topk_fold()
+static void topk_flush(bool wait) {
+    TopKSites* topk = top_sites;
+    topk_local_epoch = topk_epoch;
+    if (!topk_pending_count) return;
+    TopKPending batch[TOPK_PENDING];
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < TOPK_PENDING; i++) {
+        if (topk_pending[i].site_id) {
+            batch[count++] = topk_pending[i];
+            topk_pending[i].site_id = 0;
+        }
+    }
+    topk_pending_count = 0;
+    if (topk) topk_fold(topk, batch, count, wait);
+}
+
+// Thread exit: nothing left in the batch goes unaccounted
+static void topk_thread_exit(void*) {
+    topk_flush(true);
+}
+
+// One malloc (+size) or free (-size) of site_id. Deltas are netted per
+// site in the batch, so short-lived allocations cancel before reaching
+// the summary and only growth that outlasts an epoch competes for it.
+static inline void topk_record(uint32_t site_id, int64_t bytes) {
+    TopKSites* topk = top_sites;
+    if (!topk) return;
+    if (!topk_thread_registered) {
+        // Set first: pthread_setspecific may allocate and re-enter here
+        topk_thread_registered = true;
+        pthread_setspecific(topk_thread_key, (void*)1);
+    }
+    if (topk_local_epoch != topk_epoch) topk_flush(false);
+    TopKPending& slot = topk_pending[(site_id * 2654435761u) % TOPK_PENDING];
+    if (slot.site_id != site_id + 1) {
+        if (slot.site_id) topk_fold(topk, &slot, 1, false);  // collision: fold the other site now
+        else topk_pending_count++;
+        slot.site_id = site_id + 1;
+        slot.bytes = 0;
+    }
+    slot.bytes += bytes;
+}
+
+// Scanner thread: start a new epoch, close the growth window once window_ns has passed
+static void topk_tick(uint64_t now_ns) {
+    static uint64_t window_start = 0, epoch_start = 0;
+    TopKSites* topk = top_sites;
+    if (!topk) return;
+    if (now_ns - epoch_start >= TOPK_EPOCH_NS) {
+        epoch_start = now_ns;
+        topk_epoch++;
+    }
+    topk_drain_deferred(topk);
+    if (!window_start) window_start = now_ns;
+    if (now_ns - window_start < topk->window_ns) return;
+    window_start = now_ns;
+
+    topk_lock(topk);
+    for (uint32_t i = 0; i < topk->used; i++) {
+        TopKEntry& entry = topk->entries[i];
+        entry.growth_bytes = entry.live_bytes - entry.mark_bytes;
+        entry.mark_bytes = entry.live_bytes;
+    }
+    topk_unlock(topk);
+}
+
+// area: zeroed TopKSites in shm
+static inline void topk_init(TopKSites* area) {
+    area->k = TOPK_SITES;
+    area->window_ns = TOPK_DEFAULT_WINDOW_NS;
+    if (const char* env = getenv("TOPK_WINDOW_MS")) {
+        uint64_t ms = strtoull(env, nullptr, 10);
+        if (ms) area->window_ns = ms * 1000000ULL;
+    }
+    pthread_key_create(&topk_thread_key, topk_thread_exit);
+    __atomic_store_n(&area->magic, TOPK_MAGIC, __ATOMIC_RELEASE);
+    top_sites = area;
+}
@@ -0,0 +1,349 @@
+#pragma once
+
+// Scenari di leak etichettati per misurare l'accuratezza dei detector.
+//
+// Ogni scenario gira per duration_ms, poi resta fermo per tail_ms (per dare
+// tempo al detector di vedere gli ultimi leak) e scrive le etichette:
+//
+//     address,label,t_alloc_ns,t_leak_ns,t_free_ns
+//
+// label è "leak" (mai liberato e non più usato da t_leak_ns) oppure "benign"
+// (oggetto longevo legittimo, t_free_ns = 0 se vive fino all'uscita). Gli
+// oggetti brevi del churn di sottofondo non sono etichettati: qualsiasi
+// segnalazione non etichettata è un falso positivo. I tempi sono
+// CLOCK_MONOTONIC, confrontabili con quelli dell'agent e dell'harness
+// (monitor/bench/leak_score.py).
+//
+// Le etichette e le strutture di supporto stanno in memoria mmap, così
+// l'agent non le vede come allocazioni longeve.
+
+#include <sys/mman.h>
+#include <pthread.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+
+static inline uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Allocazioni da call site distinti, come in un'applicazione reale: i
+// detector per sito vedono ogni ruolo come un sito diverso
+__attribute__((noinline)) static void* alloc_churn(size_t size) { return malloc(size); }
+__attribute__((noinline)) static void* alloc_record(size_t size) { return malloc(size); }
+__attribute__((noinline)) static void* alloc_cache_entry(size_t size) { return malloc(size); }
+__attribute__((noinline)) static void* alloc_message(size_t size) { return malloc(size); }
+__attribute__((noinline)) static void* alloc_pin(size_t size) { return malloc(size); }
+__attribute__((noinline)) static void* alloc_singleton(size_t size) { return malloc(size); }
+
+// Mappatura anonima: invisibile all'agent
+template <typename T>
+static T* map_array(size_t count) {
+    void* p = mmap(nullptr, count * sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? nullptr : (T*)p;
+}
+
+class LabelLog {
+private:
+    struct Label {
+        uint64_t address;
+        uint64_t t_alloc;
+        uint64_t t_leak;
+        uint64_t t_free;
+        uint32_t leak;
+    };
+
+    static const size_t CAPACITY = 1 << 18;
+    Label* labels;
+    std::atomic<size_t> count{0};
+
+public:
+    LabelLog() : labels(map_array<Label>(CAPACITY)) {}
+    ~LabelLog() {
+        if (labels) munmap(labels, CAPACITY * sizeof(Label));
+    }
+
+    // Restituisce l'indice dell'etichetta, o -1 se il log è pieno
+    long add(void* ptr, bool leak, uint64_t t_alloc, uint64_t t_leak = 0) {
+        size_t i = count++;
+        if (!labels || i >= CAPACITY) return -1;
+        labels[i] = {(uint64_t)(uintptr_t)ptr, t_alloc, leak ? t_leak : 0, 0, leak ? 1u : 0u};
+        return (long)i;
+    }
+
+    void mark_freed(long index) {
+        if (index >= 0) labels[index].t_free = monotonic_ns();
+    }
+
+    size_t leaks() const {
+        size_t n = 0, total = count < CAPACITY ? count.load() : CAPACITY;
+        for (size_t i = 0; i < total; i++) n += labels[i].leak;
+        return n;
+    }
+
+    bool write(const char* path) const {
+        FILE* f = fopen(path, "w");
+        if (!f) {
+            perror(path);
+            return false;
+        }
+        fprintf(f, "address,label,t_alloc_ns,t_leak_ns,t_free_ns\n");
+        size_t total = count < CAPACITY ? count.load() : CAPACITY;
+        for (size_t i = 0; i < total; i++) {
+            const Label& l = labels[i];
+            fprintf(f, "0x%llx,%s,%llu,%llu,%llu\n", (unsigned long long)l.address, l.leak ? "leak" : "benign",
+                    (unsigned long long)l.t_alloc, (unsigned long long)l.t_leak, (unsigned long long)l.t_free);
+        }
+        fclose(f);
+        return true;
+    }
+};
+
+class LeakScenarios {
+private:
+    static const int CHURN_SLOTS = 64;
+
+    LabelLog labels;
+    std::mt19937_64 rng{42};
+    int duration_ms;
+    int tail_ms;
+    bool tail_done = false;
+    void* churn_slots[CHURN_SLOTS] = {};
+    unsigned churn_pos = 0;
+
+    // Oggetti brevi di sottofondo: vivono CHURN_SLOTS operazioni (pochi ms)
+    void churn(int ops, int leak_one_in = 0) {
+        for (int i = 0; i < ops; i++) {
+            unsigned slot = churn_pos++ % CHURN_SLOTS;
+            free(churn_slots[slot]);
+            size_t size = 16 + rng() % 241;
+            void* p = alloc_churn(size);
+            if (p) memset(p, 0x11, size);
+            if (p && leak_one_in && rng() % leak_one_in == 0) {
+                // Stesso call site del churn: il leak è nascosto nel rumore
+                labels.add(p, true, monotonic_ns(), monotonic_ns());
+                p = nullptr;
+            }
+            churn_slots[slot] = p;
+        }
+    }
+
+    void drain_churn() {
+        for (void*& p : churn_slots) {
+            free(p);
+            p = nullptr;
+        }
+    }
+
+    void leak_block(size_t size) {
+        void* p = alloc_record(size);
+        if (!p) return;
+        memset(p, 0x22, size);
+        uint64_t now = monotonic_ns();
+        labels.add(p, true, now, now);
+    }
+
+    // Ciclo a tick di 1 ms: step(ms trascorsi) fa il lavoro dello scenario
+    template <typename Step>
+    void run_ticks(Step step) {
+        uint64_t start = monotonic_ns();
+        for (int tick = 0;; tick++) {
+            uint64_t elapsed_ms = (monotonic_ns() - start) / 1000000ULL;
+            if (elapsed_ms >= (uint64_t)duration_ms) break;
+            step(tick, elapsed_ms);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // Un blocco perso ogni 200 ms
+    void slow_drip() {
+        run_ticks([this](int tick, uint64_t) {
+            churn(20);
+            if (tick % 200 == 0) leak_block(512);
+        });
+    }
+
+    // Raffiche di 200 blocchi persi ogni 2 s
+    void bursty() {
+        run_ticks([this](int tick, uint64_t) {
+            churn(20);
+            if (tick % 2000 == 500) {
+                for (int i = 0; i < 200; i++) leak_block(128 + rng() % 3969);
+            }
+        });
+    }
+
+    // Cache senza eviction: le entry sono ancora raggiungibili e lette ogni
+    // tanto, ma non verranno mai rimosse
+    void cache_growth() {
+        const size_t max_entries = 1 << 16;
+        void** cache = map_array<void*>(max_entries);
+        size_t entries = 0;
+        volatile char sink = 0;
+        run_ticks([&](int tick, uint64_t) {
+            churn(20);
+            if (tick % 10 == 0 && cache && entries < max_entries) {
+                void* entry = alloc_cache_entry(256);
+                if (!entry) return;
+                memset(entry, 0x33, 256);
+                uint64_t now = monotonic_ns();
+                labels.add(entry, true, now, now);
+                cache[entries++] = entry;
+            }
+            if (entries) sink = sink + ((char*)cache[rng() % entries])[0];  // cache hit
+        });
+        if (cache) munmap(cache, max_entries * sizeof(void*));
+    }
+
+    // Un'allocazione ogni 1000 del churn (50 op/ms) non viene liberata
+    void hidden_in_churn() {
+        run_ticks([this](int, uint64_t) { churn(50, 1000); });
+    }
+
+    // Un producer alloca messaggi, un consumer li libera; i messaggi di
+    // errore (1 su 50) vengono scartati senza free dal consumer
+    void cross_thread() {
+        const size_t queue_size = 1 << 14;
+        struct Message {
+            void* ptr;
+            uint64_t t_alloc;
+            int is_error;
+        };
+        Message* queue = map_array<Message>(queue_size);
+        if (!queue) return;
+        std::atomic<size_t> head{0}, tail{0};
+        std::atomic<bool> done{false};
+
+        std::thread consumer([&]() {
+            while (true) {
+                size_t t = tail.load(std::memory_order_relaxed);
+                if (t == head.load(std::memory_order_acquire)) {
+                    if (done) break;
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                    continue;
+                }
+                Message m = queue[t % queue_size];
+                tail.store(t + 1, std::memory_order_release);
+                if (m.is_error) {
+                    labels.add(m.ptr, true, m.t_alloc, monotonic_ns());  // ownership persa
+                } else {
+                    free(m.ptr);
+                }
+            }
+        });
+
+        run_ticks([&](int, uint64_t) {
+            churn(10);
+            for (int i = 0; i < 2; i++) {
+                size_t h = head.load(std::memory_order_relaxed);
+                if (h - tail.load(std::memory_order_acquire) >= queue_size) break;
+                size_t size = 64 + rng() % 961;
+                void* msg = alloc_message(size);
+                if (!msg) break;
+                memset(msg, 0x44, size);
+                queue[h % queue_size] = {msg, monotonic_ns(), rng() % 50 == 0};
+                head.store(h + 1, std::memory_order_release);
+            }
+        });
+        done = true;
+        consumer.join();
+        munmap(queue, queue_size * sizeof(Message));
+    }
+
+    // Nessun leak: ogni 250 ms alloca blocchi sempre un po' più grandi
+    // intervallati da piccoli "pin" longevi, poi libera i blocchi. I buchi
+    // non servono al giro successivo e l'RSS cresce a parità di dati vivi
+    void fragmentation() {
+        const size_t max_pins = 1 << 14;
+        long* pin_labels = map_array<long>(max_pins);
+        void** pins = map_array<void*>(max_pins);
+        void* blocks[128];
+        size_t num_pins = 0, block_size = 1024;
+        run_ticks([&](int tick, uint64_t) {
+            churn(10);
+            // Pin array full: only churn from here on
+            if (tick % 250 != 0 || !pins || !pin_labels || num_pins == max_pins) return;
+            int num_blocks = 0;
+            while (num_blocks < 128 && num_pins < max_pins) {
+                void* block = alloc_record(block_size);
+                if (block) memset(block, 0x55, block_size);
+                blocks[num_blocks++] = block;
+                void* pin = alloc_pin(32);
+                if (!pin) continue;
+                pin_labels[num_pins] = labels.add(pin, false, monotonic_ns());
+                pins[num_pins++] = pin;
+            }
+            for (int i = 0; i < num_blocks; i++) free(blocks[i]);
+            block_size += 64;
+        });
+        hold_tail();
+        for (size_t i = 0; i < num_pins; i++) {
+            free(pins[i]);
+            labels.mark_freed(pin_labels[i]);
+        }
+        if (pins) munmap(pins, max_pins * sizeof(void*));
+        if (pin_labels) munmap(pin_labels, max_pins * sizeof(long));
+    }
+
+    // Nessun leak: configurazione/singleton allocati all'avvio, letti per
+    // tutta la vita del processo e mai liberati di proposito
+    void singleton() {
+        void* singletons[8];
+        for (void*& s : singletons) {
+            s = alloc_singleton(4096);
+            if (!s) continue;
+            memset(s, 0x66, 4096);
+            labels.add(s, false, monotonic_ns());
+        }
+        volatile char sink = 0;
+        run_ticks([&](int, uint64_t) {
+            churn(20);
+            void* s = singletons[rng() % 8];
+            if (s) sink = sink + ((char*)s)[rng() % 4096];
+        });
+    }
+
+    // Pausa finale: lo scenario resta vivo senza nuove allocazioni
+    void hold_tail() {
+        if (tail_done) return;
+        tail_done = true;
+        drain_churn();
+        std::this_thread::sleep_for(std::chrono::milliseconds(tail_ms));
+    }
+
+public:
+    LeakScenarios(int duration, int tail) : duration_ms(duration), tail_ms(tail) {}
+
+    static const char* const* names() {
+        static const char* const list[] = {"slow_drip",     "bursty",     "cache_growth", "hidden_in_churn",
+                                           "cross_thread", "fragmentation", "singleton",    nullptr};
+        return list;
+    }
+
+    bool run(const std::string& name, const char* labels_path) {
+        printf("[SCENARIO] %s: %d ms + %d ms tail\n", name.c_str(), duration_ms, tail_ms);
+        fflush(stdout);
+
+        if (name == "slow_drip") slow_drip();
+        else if (name == "bursty") bursty();
+        else if (name == "cache_growth") cache_growth();
+        else if (name == "hidden_in_churn") hidden_in_churn();
+        else if (name == "cross_thread") cross_thread();
+        else if (name == "fragmentation") fragmentation();
+        else if (name == "singleton") singleton();
+        else return false;
+        hold_tail();
+
+        printf("[SCENARIO] %s done: %zu leaked objects\n", name.c_str(), labels.leaks());
+        return !labels_path || labels.write(labels_path);
+    }
+};
@@ -2,9 +2,15 @@
 #include <chrono>
 #include <thread>
 #include <vector>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <string>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <unistd.h>
+#include "leak_scenarios.h"
 
 class BuggyApp {
 private:
@@ -62,11 +68,216 @@ public:
     }
 };
 
+// Generatore di carico multithread per il lavoro sulle prestazioni degli agent:
+// N thread, distribuzione delle dimensioni configurabile, free cross-thread,
+// crescita via realloc e un target di operazioni al secondo.
+struct WorkloadConfig {
+    int threads = 4;
+    double ops_per_sec = 0;         // totale su tutti i thread, 0 = nessun limite
+    int duration_ms = 5000;
+    std::string distribution = "mixed";
+    int live_per_thread = 1000;     // blocchi vivi per thread a regime
+    int cross_free_pct = 10;        // % di free eseguite da un altro thread
+    int realloc_pct = 10;           // % di operazioni che fanno crescere un blocco
+};
+
+struct SizeBand {
+    double weight;
+    size_t lo, hi;
+};
+
+// churn: tanti oggetti piccoli e brevi; tensor: blocchi grandi tipo tensori ML
+// con un po' di metadati piccoli; mixed: code dominato dai piccoli, byte dai grandi
+static const std::vector<SizeBand>* find_distribution(const std::string& name) {
+    static const std::vector<SizeBand> churn = {{0.80, 16, 64}, {0.20, 65, 256}};
+    static const std::vector<SizeBand> mixed = {
+        {0.70, 16, 64}, {0.20, 65, 1024}, {0.099, 1025, 65536}, {0.001, 1 << 20, 4 << 20}};
+    static const std::vector<SizeBand> tensor = {
+        {0.50, 32, 512}, {0.30, 64 << 10, 1 << 20}, {0.20, 1 << 20, 16 << 20}};
+    if (name == "churn") return &churn;
+    if (name == "mixed") return &mixed;
+    if (name == "tensor") return &tensor;
+    return nullptr;
+}
+
+class WorkloadGenerator {
+private:
+    struct Mailbox {
+        std::mutex lock;
+        std::vector<void*> blocks;  // blocchi da liberare per conto di un altro thread
+    };
+
+    struct ThreadStats {
+        uint64_t mallocs = 0, frees = 0, reallocs = 0, cross_frees = 0, failures = 0;
+    };
+
+    WorkloadConfig config;
+    const std::vector<SizeBand>& bands;
+    std::vector<Mailbox> mailboxes;
+    std::vector<ThreadStats> stats;
+
+    size_t draw_size(std::mt19937_64& rng) {
+        double r = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        for (const SizeBand& b : bands) {
+            if (r < b.weight) return std::uniform_int_distribution<size_t>(b.lo, b.hi)(rng);
+            r -= b.weight;
+        }
+        return std::uniform_int_distribution<size_t>(bands.back().lo, bands.back().hi)(rng);
+    }
+
+    // Scrive solo la prima pagina: il costo resta sull'allocatore, non su memset
+    static void touch(void* ptr, size_t size) {
+        memset(ptr, 0xAB, size < 4096 ? size : 4096);
+    }
+
+    void drain_mailbox(int id) {
+        std::vector<void*> blocks;
+        {
+            std::lock_guard<std::mutex> guard(mailboxes[id].lock);
+            blocks.swap(mailboxes[id].blocks);
+        }
+        for (void* ptr : blocks) free(ptr);
+        stats[id].cross_frees += blocks.size();
+        stats[id].frees += blocks.size();
+    }
+
+    void worker(int id) {
+        std::mt19937_64 rng(0x5eed + id);
+        std::uniform_int_distribution<int> pct(0, 99);
+        std::vector<std::pair<void*, size_t>> live;
+        live.reserve(config.live_per_thread);
+        ThreadStats& st = stats[id];
+
+        double thread_rate = config.ops_per_sec / config.threads;
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + std::chrono::milliseconds(config.duration_ms);
+        uint64_t ops = 0;
+
+        while (true) {
+            // Controlla tempo e mailbox ogni 64 operazioni
+            if ((ops & 63) == 0) {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= deadline) break;
+                drain_mailbox(id);
+                if (thread_rate > 0) {
+                    auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                           std::chrono::duration<double>(ops / thread_rate));
+                    if (due > now) std::this_thread::sleep_until(due);
+                }
+            }
+            ops++;
+
+            if (!live.empty() && pct(rng) < config.realloc_pct) {
+                // Crescita tipo buffer dinamico: 1.5x-2x, poi ricomincia da una
+                // dimensione nuova per non crescere all'infinito
+                size_t idx = rng() % live.size();
+                size_t old_size = live[idx].second;
+                size_t new_size = old_size >= bands.back().hi ? draw_size(rng)
+                                                               : old_size + old_size / 2 + rng() % (old_size / 2 + 1);
+                void* grown = realloc(live[idx].first, new_size);
+                if (!grown) {
+                    st.failures++;
+                    continue;
+                }
+                touch(grown, new_size);
+                live[idx] = {grown, new_size};
+                st.reallocs++;
+                continue;
+            }
+
+            if ((int)live.size() >= config.live_per_thread) {
+                size_t idx = rng() % live.size();
+                void* victim = live[idx].first;
+                live[idx] = live.back();
+                live.pop_back();
+                if (config.threads > 1 && pct(rng) < config.cross_free_pct) {
+                    int peer = (id + 1 + rng() % (config.threads - 1)) % config.threads;
+                    std::lock_guard<std::mutex> guard(mailboxes[peer].lock);
+                    mailboxes[peer].blocks.push_back(victim);
+                } else {
+                    free(victim);
+                    st.frees++;
+                }
+                continue;
+            }
+
+            size_t size = draw_size(rng);
+            void* ptr = malloc(size);
+            if (!ptr) {
+                st.failures++;
+                continue;
+            }
+            touch(ptr, size);
+            live.push_back({ptr, size});
+            st.mallocs++;
+        }
+
+        // Pulizia finale, fuori dalle statistiche
+        for (auto& block : live) free(block.first);
+    }
+
+public:
+    WorkloadGenerator(const WorkloadConfig& cfg, const std::vector<SizeBand>& dist)
+        : config(cfg), bands(dist), mailboxes(cfg.threads), stats(cfg.threads) {}
+
+    void run() {
+        std::cout << "[STRESS] " << config.threads << " threads, distribution " << config.distribution
+                  << ", target " << (config.ops_per_sec > 0 ? std::to_string((long)config.ops_per_sec) : "max")
+                  << " ops/s for " << config.duration_ms << " ms" << std::endl;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (int i = 0; i < config.threads; i++) {
+            workers.emplace_back(&WorkloadGenerator::worker, this, i);
+        }
+        for (auto& w : workers) w.join();
+        // Blocchi passati a thread già terminati
+        for (int i = 0; i < config.threads; i++) drain_mailbox(i);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        ThreadStats total;
+        for (const ThreadStats& st : stats) {
+            total.mallocs += st.mallocs;
+            total.frees += st.frees;
+            total.reallocs += st.reallocs;
+            total.cross_frees += st.cross_frees;
+            total.failures += st.failures;
+        }
+        uint64_t ops = total.mallocs + total.frees + total.reallocs;
+        std::printf("[STRESS] %llu ops in %.2f s (%.0f ops/s): malloc %llu, free %llu "
+                    "(cross-thread %llu), realloc %llu, failures %llu\n",
+                    (unsigned long long)ops, elapsed, ops / elapsed, (unsigned long long)total.mallocs,
+                    (unsigned long long)total.frees, (unsigned long long)total.cross_frees,
+                    (unsigned long long)total.reallocs, (unsigned long long)total.failures);
+    }
+};
+
+static bool parse_stress_args(int argc, char* argv[], WorkloadConfig& cfg) {
+    for (int i = 2; i < argc; i++) {
+        std::string key = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (key == "--threads") cfg.threads = atoi(value);
+        else if (key == "--rate") cfg.ops_per_sec = atof(value);
+        else if (key == "--duration-ms") cfg.duration_ms = atoi(value);
+        else if (key == "--dist") cfg.distribution = value;
+        else if (key == "--live") cfg.live_per_thread = atoi(value);
+        else if (key == "--cross-free") cfg.cross_free_pct = atoi(value);
+        else if (key == "--realloc") cfg.realloc_pct = atoi(value);
+        else return false;
+    }
+    return cfg.threads > 0 && cfg.duration_ms > 0 && cfg.live_per_thread > 0 && cfg.ops_per_sec >= 0;
+}
+
 int main(int argc, char* argv[]) {
     std::cout << "=== MEMORY LEAK TEST APPLICATION ===" << std::endl;
     std::cout << "PID: " << getpid() << std::endl;
     std::cout << "Usage: " << argv[0] << " [mode]" << std::endl;
     std::cout << "Modes: normal, leak, or no arguments for both" << std::endl;
+    std::cout << "       stress [--threads N] [--rate OPS] [--duration-ms MS] [--dist churn|mixed|tensor]"
+              << std::endl;
+    std::cout << "              [--live N] [--cross-free PCT] [--realloc PCT]" << std::endl;
+    std::cout << "       scenario NAME [--duration-ms MS] [--tail-ms MS] [--labels FILE]" << std::endl;
     
     BuggyApp app;
     
@@ -75,6 +286,39 @@ int main(int argc, char* argv[]) {
         mode = argv[1];
     }
     
+    if(mode == "scenario") {
+        int duration_ms = 10000, tail_ms = 5000;
+        const char* labels_path = nullptr;
+        for(int i = 3; i + 1 < argc; i += 2) {
+            std::string key = argv[i];
+            if(key == "--duration-ms") duration_ms = atoi(argv[i + 1]);
+            else if(key == "--tail-ms") tail_ms = atoi(argv[i + 1]);
+            else if(key == "--labels") labels_path = argv[i + 1];
+        }
+        LeakScenarios scenarios(duration_ms, tail_ms);
+        if(argc < 3 || !scenarios.run(argv[2], labels_path)) {
+            std::cerr << "Scenarios:";
+            for(const char* const* n = LeakScenarios::names(); *n; n++) std::cerr << " " << *n;
+            std::cerr << std::endl;
+            return 1;
+        }
+        // Uscita normale: nessun distruttore libera i leak, e quello
+        // dell'agent rimuove il suo segmento shm
+        return 0;
+    }
+    
+    if(mode == "stress") {
+        WorkloadConfig cfg;
+        const std::vector<SizeBand>* dist = nullptr;
+        if(!parse_stress_args(argc, argv, cfg) || !(dist = find_distribution(cfg.distribution))) {
+            std::cerr << "Invalid stress arguments" << std::endl;
+            return 1;
+        }
+        WorkloadGenerator(cfg, *dist).run();
+        std::cout << "\n=== APPLICATION ENDING ===" << std::endl;
+        return 0;
+    }
+    
     if(mode == "normal" || mode == "both") {
         app.normal_operations();
     }